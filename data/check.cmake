@@ -0,0 +1,19 @@
+# The script is run from a copy in the build directory, twice, so that a cache
+# written by the first run next to the copy is read by the second.
+configure_file(${SCRIPT} ${NAME}.monkey COPYONLY)
+file(REMOVE ${NAME}.monkeyc)
+file(READ ${EXPECTED} expected)
+separate_arguments(ARGUMENTS)
+
+foreach(run 1 2)
+  execute_process(
+    COMMAND ${MAIN} ${ARGUMENTS} ${NAME}.monkey
+    OUTPUT_VARIABLE output
+    RESULT_VARIABLE result
+  )
+  if(NOT result EQUAL RESULT)
+    message(FATAL_ERROR "${MAIN} ${ARGUMENTS} ${SCRIPT} exited with ${result}:\n${output}")
+  elseif(NOT output STREQUAL expected)
+    message(FATAL_ERROR "${MAIN} ${ARGUMENTS} ${SCRIPT} printed:\n${output}\nexpected:\n${expected}")
+  endif()
+endforeach()
@@ -0,0 +1,106 @@
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "monkey/arena.h"
+
+#define ARENA_CHUNK_SIZE 65536
+
+/*
+ * The arena hands out memory from large chunks that are only released
+ * together, when the arena itself is freed. Allocations are rounded up so that
+ * every allocation is suitably aligned for any type.
+ */
+ArenaChunk* arena_chunk_new(ArenaChunk* next, size_t capacity)
+{
+    ArenaChunk* chunk = (ArenaChunk*)malloc(sizeof(ArenaChunk) + capacity);
+    chunk->next = next;
+    chunk->size = 0;
+    chunk->capacity = capacity;
+    return chunk;
+}
+
+void arena_init(Arena* arena)
+{
+    arena->chunk = NULL;
+}
+
+void arena_free(Arena* arena)
+{
+    while (arena->chunk != NULL) {
+        ArenaChunk* next = arena->chunk->next;
+        free(arena->chunk);
+        arena->chunk = next;
+    }
+}
+
+/*
+ * Mark the current end of an arena. Large allocations are placed behind the
+ * current chunk, so the chunk that followed it is remembered as well.
+ */
+ArenaMark arena_mark(const Arena* arena)
+{
+    ArenaChunk* chunk = arena->chunk;
+    return (ArenaMark) { chunk, chunk == NULL ? 0 : chunk->size, chunk == NULL ? NULL : chunk->next };
+}
+
+/*
+ * Release everything allocated from the arena since it was marked, so that an
+ * arena used for one short lived tree after another keeps reusing the same
+ * memory.
+ */
+void arena_release(Arena* arena, ArenaMark mark)
+{
+    while (arena->chunk != mark.chunk) {
+        ArenaChunk* next = arena->chunk->next;
+        free(arena->chunk);
+        arena->chunk = next;
+    }
+    if (mark.chunk == NULL) {
+        return;
+    }
+    while (mark.chunk->next != mark.next) {
+        ArenaChunk* next = mark.chunk->next->next;
+        free(mark.chunk->next);
+        mark.chunk->next = next;
+    }
+    mark.chunk->size = mark.size;
+}
+
+/*
+ * Move every allocation of an arena into another one, which then releases them
+ * when it is freed. The source arena is left empty.
+ */
+void arena_take(Arena* arena, Arena* source)
+{
+    if (source->chunk == NULL) {
+        return;
+    }
+    ArenaChunk* last = source->chunk;
+    while (last->next != NULL) {
+        last = last->next;
+    }
+    last->next = arena->chunk;
+    arena->chunk = source->chunk;
+    source->chunk = NULL;
+}
+
+void* arena_allocate(Arena* arena, size_t size)
+{
+    size = (size + sizeof(max_align_t) - 1) / sizeof(max_align_t) * sizeof(max_align_t);
+
+    ArenaChunk* chunk = arena->chunk;
+    if (chunk == NULL || chunk->capacity - chunk->size < size) {
+        if (size > ARENA_CHUNK_SIZE / 4 && chunk != NULL) {
+            // large allocations get a chunk of their own behind the current one
+            chunk->next = arena_chunk_new(chunk->next, size);
+            chunk->next->size = size;
+            return chunk->next->data;
+        }
+        chunk = arena_chunk_new(chunk, size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE);
+        arena->chunk = chunk;
+    }
+
+    void* data = (char*)chunk->data + chunk->size;
+    chunk->size += size;
+    return data;
+}
@@ -0,0 +1,147 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "monkey/arena.h"
+#include "monkey/bytecode.h"
+#include "monkey/hash.h"
+#include "monkey/object.h"
+#include "monkey/scope.h"
+#include "monkey/symbol.h"
+
+void code_init(Code* code)
+{
+    code->bytes = NULL;
+    code->size = 0;
+    code->capacity = 0;
+    code->parameters = 0;
+    code->locals = 0;
+    code->names = NULL;
+}
+
+void code_free(const Code* code)
+{
+    free(code->bytes);
+    free(code->names);
+}
+
+bool code_emit(Code* code, uint8_t byte)
+{
+    if (code->size >= code->capacity) {
+        code->capacity = code->capacity == 0 ? 64 : 2 * code->capacity;
+        code->bytes = (uint8_t*)realloc(code->bytes, code->capacity);
+    }
+    code->bytes[code->size++] = byte;
+    return true;
+}
+
+bool code_emit_operand(Code* code, size_t operand)
+{
+    if (operand > BYTECODE_OPERAND_MAX) {
+        return false;
+    }
+    for (int shift = 8 * (BYTECODE_OPERAND_SIZE - 1); shift >= 0; shift -= 8) {
+        code_emit(code, (uint8_t)((operand >> shift) & 0xff));
+    }
+    return true;
+}
+
+void code_patch_operand(Code* code, size_t offset, size_t operand)
+{
+    for (size_t i = 0; i < BYTECODE_OPERAND_SIZE; ++i) {
+        code->bytes[offset + i] = (uint8_t)((operand >> (8 * (BYTECODE_OPERAND_SIZE - 1 - i))) & 0xff);
+    }
+}
+
+size_t code_add_local(Code* code, const Symbol* name)
+{
+    code->names = (const Symbol**)realloc(code->names, (code->locals + 1) * sizeof(Symbol*));
+    code->names[code->locals] = name;
+    return code->locals++;
+}
+
+void bytecode_init(Bytecode* bytecode)
+{
+    bytecode->codes = NULL;
+    bytecode->codes_size = 0;
+    bytecode->codes_capacity = 0;
+    bytecode->constants = NULL;
+    bytecode->constants_size = 0;
+    bytecode->constants_capacity = 0;
+    hash_init(&bytecode->constant_index);
+    arena_init(&bytecode->constant_keys);
+    bytecode->globals = NULL;
+}
+
+void bytecode_free_index(void* value)
+{
+    (void)value;
+}
+
+void bytecode_free(Bytecode* bytecode)
+{
+    for (size_t i = 0; i < bytecode->codes_size; ++i) {
+        code_free(&bytecode->codes[i]);
+    }
+    free(bytecode->codes);
+    for (size_t i = 0; i < bytecode->constants_size; ++i) {
+        object_free(&bytecode->constants[i]);
+    }
+    free(bytecode->constants);
+    hash_free(&bytecode->constant_index, bytecode_free_index);
+    arena_free(&bytecode->constant_keys);
+}
+
+size_t bytecode_add_code(Bytecode* bytecode)
+{
+    if (bytecode->codes_size >= bytecode->codes_capacity) {
+        bytecode->codes_capacity = bytecode->codes_capacity == 0 ? 8 : 2 * bytecode->codes_capacity;
+        bytecode->codes = (Code*)realloc(bytecode->codes, bytecode->codes_capacity * sizeof(Code));
+    }
+    code_init(&bytecode->codes[bytecode->codes_size]);
+    return bytecode->codes_size++;
+}
+
+size_t bytecode_append_constant(Bytecode* bytecode, const Object* object)
+{
+    if (bytecode->constants_size >= bytecode->constants_capacity) {
+        bytecode->constants_capacity = bytecode->constants_capacity == 0 ? 16 : 2 * bytecode->constants_capacity;
+        bytecode->constants = (Object*)realloc(bytecode->constants, bytecode->constants_capacity * sizeof(Object));
+    }
+    object_copy(&bytecode->constants[bytecode->constants_size], object);
+    return bytecode->constants_size++;
+}
+
+/*
+ * String constants come from literals interned in the constant pool of the
+ * program, so equal strings are keyed by the same address.
+ */
+size_t bytecode_add_constant(Bytecode* bytecode, const Object* object)
+{
+    char buffer[32];
+    int length;
+    switch (object->type) {
+    case OBJECT_INTEGER:
+        length = snprintf(buffer, sizeof(buffer), "i%d", object->integer);
+        break;
+    case OBJECT_STRING:
+        length = snprintf(buffer, sizeof(buffer), "s%p", (void*)object->string);
+        break;
+    default:
+        return bytecode_append_constant(bytecode, object);
+    }
+
+    uint64_t hash = hash_key_span(buffer, (size_t)length);
+    uintptr_t index = (uintptr_t)hash_retrieve_span(&bytecode->constant_index, buffer, (size_t)length, hash);
+    if (index != 0) {
+        return index - 1;
+    }
+
+    char* key = (char*)arena_allocate(&bytecode->constant_keys, (size_t)length + 1);
+    memcpy(key, buffer, (size_t)length + 1);
+    index = bytecode_append_constant(bytecode, object);
+    hash_insert_hash(&bytecode->constant_index, key, hash, (void*)(index + 1));
+    return index;
+}
@@ -0,0 +1,736 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "monkey/cache.h"
+#include "monkey/expression.h"
+#include "monkey/hash.h"
+#include "monkey/statement.h"
+#include "monkey/string.h"
+#include "monkey/symbol.h"
+
+/*
+ * A cache file holds a parsed program so that later runs on the same source
+ * skip lexing and parsing. It starts with a header identifying the format and
+ * the source it was produced from, followed by the tables of the symbols and
+ * the strings of the program, and the statements of the program in prefix
+ * order. The encoding has no pointers, so symbols and strings are referred to
+ * by their index in the tables, and the tables refer to the characters of each
+ * name and string by their span in the source, which the header guarantees is
+ * unchanged. Numbers are written seven bits to a byte, lowest bits first, with
+ * the high bit set on every byte but the last.
+ */
+#define CACHE_MAGIC "MKYC"
+
+typedef struct CacheHeader CacheHeader;
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t hash;
+    uint64_t size;
+    uint32_t symbols_size;
+    uint32_t strings_size;
+};
+
+/*
+ * The names or strings of a program, numbered in the order they are first
+ * written, each with the offset of its first occurrence in the source.
+ */
+typedef struct CacheEntry CacheEntry;
+struct CacheEntry {
+    const char* text;
+    size_t length;
+    size_t offset;
+};
+
+typedef struct CacheTable CacheTable;
+struct CacheTable {
+    HashTable index;
+    CacheEntry* entries;
+    size_t size;
+    size_t capacity;
+};
+
+/*
+ * Trees nest as deeply as the source allows, so they are written and read from
+ * a stack of the nodes that remain rather than by recursion. The size of a
+ * statement node is the number of statements left to read into its block.
+ */
+typedef enum CacheNodeType CacheNodeType;
+enum CacheNodeType {
+    CACHE_NODE_EXPRESSION,
+    CACHE_NODE_BLOCK,
+    CACHE_NODE_STATEMENT,
+};
+
+typedef struct CacheNode CacheNode;
+struct CacheNode {
+    CacheNodeType type;
+    void* value;
+    size_t size;
+};
+
+typedef struct CacheStack CacheStack;
+struct CacheStack {
+    CacheNode* nodes;
+    size_t size;
+    size_t capacity;
+};
+
+typedef struct CacheWriter CacheWriter;
+struct CacheWriter {
+    String buffer;
+    CacheTable symbols;
+    CacheTable strings;
+    CacheStack stack;
+};
+
+typedef struct CacheReader CacheReader;
+struct CacheReader {
+    const char* data;
+    size_t size;
+    size_t offset;
+    const Symbol** symbols;
+    size_t symbols_size;
+    ObjectString** strings;
+    size_t strings_size;
+    Arena* arena;
+    ConstantPool* constants;
+    CacheStack stack;
+};
+
+/*
+ * The cache of a source file is kept next to it, replacing the .monkey
+ * extension with .monkeyc or appending the latter to any other name.
+ */
+void cache_path(String* path, const char* source)
+{
+    size_t length = strlen(source);
+    string_init(path);
+    string_reserve(path, length + 9);
+    string_extend(path, source, length);
+    if (length >= 7 && strcmp(source + length - 7, ".monkey") == 0) {
+        string_append(path, 'c');
+    } else {
+        string_extend(path, ".monkeyc", 8);
+    }
+}
+
+void cache_push(CacheStack* stack, CacheNodeType type, void* value, size_t size)
+{
+    if (stack->size >= stack->capacity) {
+        stack->capacity = stack->capacity == 0 ? 64 : 2 * stack->capacity;
+        stack->nodes = (CacheNode*)realloc(stack->nodes, stack->capacity * sizeof(CacheNode));
+    }
+    stack->nodes[stack->size++] = (CacheNode) { type, value, size };
+}
+
+void cache_table_init(CacheTable* table)
+{
+    hash_init(&table->index);
+    table->entries = NULL;
+    table->size = 0;
+    table->capacity = 0;
+}
+
+void cache_table_free_index(void* value)
+{
+    (void)value;
+}
+
+void cache_table_free(const CacheTable* table)
+{
+    hash_free(&table->index, cache_table_free_index);
+    free(table->entries);
+}
+
+size_t cache_table_add(CacheTable* table, const char* text, size_t length, uint64_t hash)
+{
+    uintptr_t index = (uintptr_t)hash_retrieve_span(&table->index, text, length, hash);
+    if (index == 0) {
+        if (table->size >= table->capacity) {
+            table->capacity = table->capacity == 0 ? 64 : 2 * table->capacity;
+            table->entries = (CacheEntry*)realloc(table->entries, table->capacity * sizeof(CacheEntry));
+        }
+        table->entries[table->size++] = (CacheEntry) { text, length, SIZE_MAX };
+        index = table->size;
+        hash_insert_hash(&table->index, (char*)text, hash, (void*)index);
+    }
+    return index - 1;
+}
+
+/*
+ * Record the offset of a lexeme of the source if it is the first occurrence of
+ * an entry of the table, and tell whether it was.
+ */
+bool cache_table_locate(CacheTable* table, const Token* token, const char* source)
+{
+    uint64_t hash = hash_key_span(token->lexeme, token->length);
+    uintptr_t index = (uintptr_t)hash_retrieve_span(&table->index, token->lexeme, token->length, hash);
+    if (index == 0 || table->entries[index - 1].offset != SIZE_MAX) {
+        return false;
+    }
+    table->entries[index - 1].offset = (size_t)(token->lexeme - source);
+    return true;
+}
+
+void cache_write(String* buffer, const void* data, size_t size)
+{
+    string_extend(buffer, (const char*)data, size);
+}
+
+void cache_write_u8(String* buffer, uint8_t value)
+{
+    cache_write(buffer, &value, sizeof(value));
+}
+
+void cache_write_number(String* buffer, uint64_t value)
+{
+    while (value >= 0x80) {
+        cache_write_u8(buffer, (uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    cache_write_u8(buffer, (uint8_t)value);
+}
+
+void cache_write_symbol(CacheWriter* writer, const Symbol* symbol)
+{
+    const String* name = &symbol->name;
+    cache_write_number(&writer->buffer, cache_table_add(&writer->symbols, string_value(name), string_length(name), symbol->hash));
+}
+
+void cache_write_string(CacheWriter* writer, const ObjectString* constant)
+{
+    const char* text = string_value(&constant->value);
+    uint64_t hash = hash_key_span(text, constant->length);
+    cache_write_number(&writer->buffer, cache_table_add(&writer->strings, text, constant->length, hash));
+}
+
+/*
+ * Expressions specialized on what they observed are written as their general
+ * forms, since the observation need not hold the next time the program runs.
+ */
+ExpressionType cache_general_type(ExpressionType type)
+{
+    switch (type) {
+    case EXPRESSION_IDENTIFIER_INTEGER:
+        return EXPRESSION_IDENTIFIER;
+    case EXPRESSION_INFIX_INTEGER:
+        return EXPRESSION_INFIX;
+    case EXPRESSION_CALL_DIRECT:
+        return EXPRESSION_CALL;
+    default:
+        return type;
+    }
+}
+
+/*
+ * Write the fields of an expression and push its operands, so that they are
+ * written next, in order.
+ */
+void cache_write_expression(CacheWriter* writer, Expression* expression)
+{
+    cache_write_u8(&writer->buffer, (uint8_t)cache_general_type(expression->type));
+    switch (expression->type) {
+    case EXPRESSION_NONE:
+        break;
+    case EXPRESSION_INTEGER:
+        cache_write_number(&writer->buffer, (uint32_t)expression->integer.value);
+        break;
+    case EXPRESSION_BOOL:
+        cache_write_u8(&writer->buffer, expression->boolean.value);
+        break;
+    case EXPRESSION_STRING:
+        cache_write_string(writer, expression->string.constant);
+        break;
+    case EXPRESSION_IDENTIFIER:
+    case EXPRESSION_IDENTIFIER_INTEGER:
+        cache_write_symbol(writer, expression->identifier.symbol);
+        break;
+    case EXPRESSION_PREFIX:
+        cache_write_u8(&writer->buffer, (uint8_t)expression->prefix.operation);
+        cache_push(&writer->stack, CACHE_NODE_EXPRESSION, expression->prefix.operand, 0);
+        break;
+    case EXPRESSION_INFIX:
+    case EXPRESSION_INFIX_INTEGER:
+        cache_write_u8(&writer->buffer, (uint8_t)expression->infix.operation);
+        cache_push(&writer->stack, CACHE_NODE_EXPRESSION, expression->infix.operand[1], 0);
+        cache_push(&writer->stack, CACHE_NODE_EXPRESSION, expression->infix.operand[0], 0);
+        break;
+    case EXPRESSION_CONDITIONAL:
+        cache_write_u8(&writer->buffer, expression->conditional.alternate != NULL);
+        if (expression->conditional.alternate != NULL) {
+            cache_push(&writer->stack, CACHE_NODE_BLOCK, expression->conditional.alternate, 0);
+        }
+        cache_push(&writer->stack, CACHE_NODE_BLOCK, expression->conditional.consequence, 0);
+        cache_push(&writer->stack, CACHE_NODE_EXPRESSION, expression->conditional.condition, 0);
+        break;
+    case EXPRESSION_FUNCTION:
+        cache_write_number(&writer->buffer, expression->function.parameters_size);
+        for (size_t i = 0; i < expression->function.parameters_size; ++i) {
+            cache_write_symbol(writer, expression->function.parameters[i]);
+        }
+        cache_push(&writer->stack, CACHE_NODE_BLOCK, expression->function.body, 0);
+        break;
+    case EXPRESSION_CALL:
+    case EXPRESSION_CALL_DIRECT:
+        cache_write_number(&writer->buffer, expression->call.arguments_size);
+        for (size_t i = expression->call.arguments_size; i > 0; --i) {
+            cache_push(&writer->stack, CACHE_NODE_EXPRESSION, &expression->call.arguments[i - 1], 0);
+        }
+        cache_push(&writer->stack, CACHE_NODE_EXPRESSION, expression->call.function, 0);
+        break;
+    }
+}
+
+void cache_write_block(CacheWriter* writer, StatementBlock* block)
+{
+    size_t size = 0;
+    for (const Statement* statement = block->head; statement != NULL; statement = statement->next) {
+        size++;
+    }
+    cache_write_number(&writer->buffer, size);
+    if (block->head != NULL) {
+        cache_push(&writer->stack, CACHE_NODE_STATEMENT, block->head, 0);
+    }
+}
+
+void cache_write_statement(CacheWriter* writer, Statement* statement)
+{
+    cache_write_u8(&writer->buffer, (uint8_t)statement->type);
+    if (statement->type == STATEMENT_LET) {
+        cache_write_symbol(writer, statement->identifier);
+    }
+    if (statement->next != NULL) {
+        cache_push(&writer->stack, CACHE_NODE_STATEMENT, statement->next, 0);
+    }
+    cache_push(&writer->stack, CACHE_NODE_EXPRESSION, &statement->expression, 0);
+}
+
+void cache_write_program(CacheWriter* writer, const StatementBlock* block)
+{
+    cache_push(&writer->stack, CACHE_NODE_BLOCK, (void*)block, 0);
+    while (writer->stack.size > 0) {
+        CacheNode node = writer->stack.nodes[--writer->stack.size];
+        if (node.type == CACHE_NODE_EXPRESSION) {
+            cache_write_expression(writer, (Expression*)node.value);
+        } else if (node.type == CACHE_NODE_BLOCK) {
+            cache_write_block(writer, (StatementBlock*)node.value);
+        } else {
+            cache_write_statement(writer, (Statement*)node.value);
+        }
+    }
+}
+
+/*
+ * Find the first occurrence in the source of every name and string written,
+ * which lexing the source again up to the last of them yields.
+ */
+bool cache_locate(CacheWriter* writer, const Lexer* lexer)
+{
+    LexerRange range = { 0, lexer->size, 1, 0 };
+    Lexer source;
+    lexer_init_buffer(&source, lexer->source, &range);
+
+    size_t remaining = writer->symbols.size + writer->strings.size;
+    while (remaining > 0) {
+        Token token = lexer_token_next(&source);
+        if (token.type == TOKEN_END) {
+            return false;
+        } else if (token.type == TOKEN_IDENTIFIER && cache_table_locate(&writer->symbols, &token, lexer->source)) {
+            remaining--;
+        } else if (token.type == TOKEN_STRING && cache_table_locate(&writer->strings, &token, lexer->source)) {
+            remaining--;
+        }
+    }
+    return true;
+}
+
+void cache_write_table(String* buffer, const CacheTable* table)
+{
+    for (size_t i = 0; i < table->size; ++i) {
+        cache_write_number(buffer, table->entries[i].length);
+        cache_write_number(buffer, table->entries[i].offset);
+    }
+}
+
+/*
+ * Write the cache of a program that was parsed from the given source. The
+ * file is written under a temporary name and then renamed, so that concurrent
+ * runs never see a partial cache. Failing to write the cache is not an error.
+ */
+void cache_store(const char* path, const Lexer* lexer, const StatementBlock* block)
+{
+    CacheWriter writer;
+    string_init(&writer.buffer);
+    cache_table_init(&writer.symbols);
+    cache_table_init(&writer.strings);
+    writer.stack = (CacheStack) { NULL, 0, 0 };
+    cache_write_program(&writer, block);
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.hash = hash_key_span(lexer->source, lexer->size);
+    header.size = lexer->size;
+    header.symbols_size = (uint32_t)writer.symbols.size;
+    header.strings_size = (uint32_t)writer.strings.size;
+
+    // the tables are filled by writing the tree, but precede it in the file
+    String tables;
+    string_init(&tables);
+    bool located = cache_locate(&writer, lexer);
+    cache_write_table(&tables, &writer.symbols);
+    cache_write_table(&tables, &writer.strings);
+
+    char temporary[4096];
+    snprintf(temporary, sizeof(temporary), "%s.%ld", path, (long)getpid());
+    FILE* file = located ? fopen(temporary, "wb") : NULL;
+    if (file != NULL) {
+        bool result = fwrite(&header, sizeof(header), 1, file) == 1;
+        if (result && string_length(&tables) > 0) {
+            result = fwrite(string_value(&tables), string_length(&tables), 1, file) == 1;
+        }
+        if (result && string_length(&writer.buffer) > 0) {
+            result = fwrite(string_value(&writer.buffer), string_length(&writer.buffer), 1, file) == 1;
+        }
+        if (fclose(file) == 0 && result) {
+            rename(temporary, path);
+        } else {
+            remove(temporary);
+        }
+    }
+
+    string_free(&tables);
+    cache_table_free(&writer.symbols);
+    cache_table_free(&writer.strings);
+    free(writer.stack.nodes);
+    string_free(&writer.buffer);
+}
+
+/*
+ * Every read is checked against the end of the cache, so that a truncated or
+ * corrupt cache is rejected instead of producing a broken program.
+ */
+bool cache_read(CacheReader* reader, void* data, size_t size)
+{
+    if (size > reader->size - reader->offset) {
+        return false;
+    }
+    memcpy(data, reader->data + reader->offset, size);
+    reader->offset += size;
+    return true;
+}
+
+bool cache_read_u8(CacheReader* reader, uint8_t* value)
+{
+    return cache_read(reader, value, sizeof(*value));
+}
+
+bool cache_read_number(CacheReader* reader, uint64_t* value)
+{
+    *value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        uint8_t byte;
+        if (!cache_read_u8(reader, &byte)) {
+            return false;
+        }
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Read the length of a sequence of items, each of which takes at least one
+ * byte, so that a corrupt length is rejected before it is allocated.
+ */
+bool cache_read_size(CacheReader* reader, size_t* size)
+{
+    uint64_t value;
+    if (!cache_read_number(reader, &value) || value > reader->size - reader->offset) {
+        return false;
+    }
+    *size = (size_t)value;
+    return true;
+}
+
+bool cache_read_index(CacheReader* reader, size_t size, size_t* index)
+{
+    uint64_t value;
+    if (!cache_read_number(reader, &value) || value >= size) {
+        return false;
+    }
+    *index = (size_t)value;
+    return true;
+}
+
+bool cache_read_symbol(CacheReader* reader, const Symbol** symbol)
+{
+    size_t index;
+    if (!cache_read_index(reader, reader->symbols_size, &index)) {
+        return false;
+    }
+    *symbol = reader->symbols[index];
+    return true;
+}
+
+bool cache_read_string(CacheReader* reader, Expression* expression)
+{
+    size_t index;
+    if (!cache_read_index(reader, reader->strings_size, &index)) {
+        return false;
+    }
+    return expression_init_string(expression, reader->strings[index]);
+}
+
+/*
+ * Allocate an empty block and push it to be read.
+ */
+StatementBlock* cache_read_block_push(CacheReader* reader)
+{
+    StatementBlock* block = (StatementBlock*)arena_allocate(reader->arena, sizeof(StatementBlock));
+    statement_block_init(block);
+    cache_push(&reader->stack, CACHE_NODE_BLOCK, block, 0);
+    return block;
+}
+
+/*
+ * Expressions are initialized before their operands are read, so that an
+ * expression that is only partially read can still be freed. The operands are
+ * pushed so that they are read next, in order.
+ */
+bool cache_read_expression(CacheReader* reader, Expression* expression)
+{
+    uint8_t type;
+    uint8_t value;
+    uint64_t integer;
+    const Symbol* symbol;
+    size_t size;
+    if (!cache_read_u8(reader, &type)) {
+        return false;
+    }
+
+    switch ((ExpressionType)type) {
+    case EXPRESSION_NONE:
+        return true;
+    case EXPRESSION_INTEGER:
+        return cache_read_number(reader, &integer) && integer <= UINT32_MAX && expression_init_integer(expression, (int)(uint32_t)integer);
+    case EXPRESSION_BOOL:
+        return cache_read_u8(reader, &value) && expression_init_bool(expression, value != 0);
+    case EXPRESSION_STRING:
+        return cache_read_string(reader, expression);
+    case EXPRESSION_IDENTIFIER:
+        return cache_read_symbol(reader, &symbol) && expression_init_identifier(expression, symbol);
+    case EXPRESSION_PREFIX:
+        if (!cache_read_u8(reader, &value)) {
+            return false;
+        }
+        expression_init_prefix(expression, reader->arena, (Operation)value);
+        cache_push(&reader->stack, CACHE_NODE_EXPRESSION, expression->prefix.operand, 0);
+        return true;
+    case EXPRESSION_INFIX:
+        if (!cache_read_u8(reader, &value)) {
+            return false;
+        }
+        expression_init_infix(expression, reader->arena, expression_new(reader->arena), (Operation)value);
+        cache_push(&reader->stack, CACHE_NODE_EXPRESSION, expression->infix.operand[1], 0);
+        cache_push(&reader->stack, CACHE_NODE_EXPRESSION, expression->infix.operand[0], 0);
+        return true;
+    case EXPRESSION_CONDITIONAL:
+        if (!cache_read_u8(reader, &value)) {
+            return false;
+        }
+        expression_init_conditional(expression, reader->arena);
+        if (value != 0) {
+            expression->conditional.alternate = cache_read_block_push(reader);
+        }
+        expression->conditional.consequence = cache_read_block_push(reader);
+        cache_push(&reader->stack, CACHE_NODE_EXPRESSION, expression->conditional.condition, 0);
+        return true;
+    case EXPRESSION_FUNCTION:
+        if (!expression_init_function(expression) || !cache_read_size(reader, &size)) {
+            return false;
+        } else if (size > 0) {
+            expression->function.parameters = (const Symbol**)arena_allocate(reader->arena, size * sizeof(Symbol*));
+            for (size_t i = 0; i < size; ++i) {
+                if (!cache_read_symbol(reader, &expression->function.parameters[i])) {
+                    return false;
+                }
+            }
+            expression->function.parameters_size = size;
+        }
+        expression->function.body = cache_read_block_push(reader);
+        return true;
+    case EXPRESSION_CALL:
+        if (!expression_init_call(expression, expression_new(reader->arena)) || !cache_read_size(reader, &size)) {
+            return false;
+        } else if (size > 0) {
+            expression->call.arguments = (Expression*)arena_allocate(reader->arena, size * sizeof(Expression));
+            for (size_t i = 0; i < size; ++i) {
+                expression->call.arguments[i].type = EXPRESSION_NONE;
+            }
+            expression->call.arguments_size = size;
+            for (size_t i = size; i > 0; --i) {
+                cache_push(&reader->stack, CACHE_NODE_EXPRESSION, &expression->call.arguments[i - 1], 0);
+            }
+        }
+        cache_push(&reader->stack, CACHE_NODE_EXPRESSION, expression->call.function, 0);
+        return true;
+    case EXPRESSION_IDENTIFIER_INTEGER:
+    case EXPRESSION_INFIX_INTEGER:
+    case EXPRESSION_CALL_DIRECT:
+        // specialized expressions are only ever written in their general forms
+        return false;
+    }
+    return false;
+}
+
+bool cache_read_block(CacheReader* reader, StatementBlock* block)
+{
+    size_t size;
+    if (!cache_read_size(reader, &size)) {
+        return false;
+    } else if (size > 0) {
+        cache_push(&reader->stack, CACHE_NODE_STATEMENT, block, size);
+    }
+    return true;
+}
+
+/*
+ * Read the next statement of a block, then its expression before the
+ * statements that follow it.
+ */
+bool cache_read_statement(CacheReader* reader, StatementBlock* block, size_t size)
+{
+    uint8_t type;
+    const Symbol* symbol;
+    Statement statement;
+    if (!cache_read_u8(reader, &type)) {
+        return false;
+    } else if (type == STATEMENT_LET) {
+        if (!cache_read_symbol(reader, &symbol)) {
+            return false;
+        }
+        statement_init_let(&statement, symbol);
+    } else if (type == STATEMENT_RETURN) {
+        statement_init_return(&statement);
+    } else if (type == STATEMENT_EXPRESSION) {
+        statement_init_expression(&statement);
+    } else {
+        return false;
+    }
+
+    statement_block_extend(block, reader->arena, &statement);
+    if (size > 1) {
+        cache_push(&reader->stack, CACHE_NODE_STATEMENT, block, size - 1);
+    }
+    cache_push(&reader->stack, CACHE_NODE_EXPRESSION, &block->tail->expression, 0);
+    return true;
+}
+
+/*
+ * Read an entry of the table of names or of strings, as a span of the source.
+ */
+bool cache_read_entry(CacheReader* reader, const Lexer* lexer, const char** text, size_t* length)
+{
+    uint64_t offset;
+    uint64_t size;
+    if (!cache_read_number(reader, &size) || !cache_read_number(reader, &offset)) {
+        return false;
+    } else if (offset > lexer->size || size > lexer->size - offset) {
+        return false;
+    }
+    *text = lexer->source + offset;
+    *length = (size_t)size;
+    return true;
+}
+
+bool cache_read_program(CacheReader* reader, const Lexer* lexer, StatementBlock* block)
+{
+    CacheHeader header;
+    if (!cache_read(reader, &header, sizeof(header))) {
+        return false;
+    } else if (memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0 || header.version != CACHE_VERSION) {
+        return false;
+    } else if (header.size != lexer->size || header.hash != hash_key_span(lexer->source, lexer->size)) {
+        return false;
+    } else if (header.symbols_size > reader->size - reader->offset || header.strings_size > reader->size - reader->offset) {
+        return false;
+    }
+
+    const char* text;
+    size_t length;
+    reader->symbols = (const Symbol**)malloc((header.symbols_size + 1) * sizeof(Symbol*));
+    for (size_t i = 0; i < header.symbols_size; ++i) {
+        if (!cache_read_entry(reader, lexer, &text, &length)) {
+            return false;
+        }
+        reader->symbols[reader->symbols_size++] = symbol_intern_span(text, length);
+    }
+    reader->strings = (ObjectString**)malloc((header.strings_size + 1) * sizeof(ObjectString*));
+    for (size_t i = 0; i < header.strings_size; ++i) {
+        if (!cache_read_entry(reader, lexer, &text, &length)) {
+            return false;
+        }
+        reader->strings[reader->strings_size++] = constant_pool_string(reader->constants, text, length);
+    }
+
+    bool result = cache_read_block(reader, block);
+    while (result && reader->stack.size > 0) {
+        CacheNode node = reader->stack.nodes[--reader->stack.size];
+        if (node.type == CACHE_NODE_EXPRESSION) {
+            result = cache_read_expression(reader, (Expression*)node.value);
+        } else if (node.type == CACHE_NODE_BLOCK) {
+            result = cache_read_block(reader, (StatementBlock*)node.value);
+        } else {
+            result = cache_read_statement(reader, (StatementBlock*)node.value, node.size);
+        }
+    }
+    return result && reader->offset == reader->size;
+}
+
+/*
+ * Load the program of the given source from its cache, if there is one that
+ * was produced from the same source by the same version of the cache format.
+ * The block is left empty when the cache cannot be used.
+ */
+bool cache_load(const char* path, const Lexer* lexer, Arena* arena, ConstantPool* constants, StatementBlock* block)
+{
+    int descriptor = open(path, O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    struct stat status;
+    void* data = MAP_FAILED;
+    if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+        data = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    }
+    close(descriptor);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    CacheReader reader = { (const char*)data, (size_t)status.st_size, 0, NULL, 0, NULL, 0, arena, constants, { NULL, 0, 0 } };
+    bool result = cache_read_program(&reader, lexer, block);
+    if (!result) {
+        statement_block_free(block);
+        statement_block_init(block);
+    }
+
+    free(reader.symbols);
+    free(reader.strings);
+    free(reader.stack.nodes);
+    munmap(data, (size_t)status.st_size);
+    return result;
+}
@@ -0,0 +1,649 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "monkey/arena.h"
+#include "monkey/closure.h"
+#include "monkey/environment.h"
+#include "monkey/eval.h"
+#include "monkey/expression.h"
+#include "monkey/object.h"
+#include "monkey/stack.h"
+#include "monkey/statement.h"
+
+/*
+ * The closures behave exactly as the expressions they are compiled from do
+ * when evaluated, down to the order of evaluation and the errors reported.
+ * Operations and variables are specialized when compiled, on their operation
+ * and on the kind of their binding, and the operations on integers run
+ * without calling into the evaluator.
+ */
+
+bool closure_run(const Closure* closure, Environment* environment, Object* object)
+{
+    return closure->function(closure, environment, object);
+}
+
+bool closure_integer(const Closure* closure, Environment* environment, Object* object)
+{
+    (void)environment;
+    return object_init_integer(object, closure->integer);
+}
+
+bool closure_bool(const Closure* closure, Environment* environment, Object* object)
+{
+    (void)environment;
+    return object_init_bool(object, closure->boolean);
+}
+
+bool closure_string(const Closure* closure, Environment* environment, Object* object)
+{
+    (void)environment;
+    return object_init_string_constant(object, closure->string);
+}
+
+bool closure_function(const Closure* closure, Environment* environment, Object* object)
+{
+    (void)environment;
+    return object_init_function(object, closure->literal);
+}
+
+bool closure_unexpected(const Closure* closure, Environment* environment, Object* object)
+{
+    (void)closure;
+    (void)environment;
+    (void)object;
+    printf("*** EVALUATION ERROR: unexpected expression type\n");
+    return false;
+}
+
+bool closure_variable_copy(const Closure* closure, const Object* value, Object* object)
+{
+    if (value == NULL || value->type == OBJECT_NONE) {
+        printf("*** EVALUATION ERROR: missing variable: %s\n", string_value(&closure->variable.symbol->name));
+        return false;
+    }
+    return object_copy(object, value);
+}
+
+bool closure_variable(const Closure* closure, Environment* environment, Object* object)
+{
+    return closure_variable_copy(closure, environment_lookup(environment, &closure->variable.binding), object);
+}
+
+bool closure_variable_local(const Closure* closure, Environment* environment, Object* object)
+{
+    return closure_variable_copy(closure, &environment->objects[closure->variable.binding.slot], object);
+}
+
+bool closure_variable_global(const Closure* closure, Environment* environment, Object* object)
+{
+    return closure_variable_copy(closure, &environment->global->objects[closure->variable.binding.slot], object);
+}
+
+bool closure_negative(const Closure* closure, Environment* environment, Object* object)
+{
+    if (!closure_run(closure->operation.operand[0], environment, object)) {
+        return false;
+    } else if (object->type != OBJECT_INTEGER) {
+        return evaluate_prefix_operation(OPERATION_NEGATIVE, object);
+    }
+    object->integer *= -1;
+    return true;
+}
+
+bool closure_not(const Closure* closure, Environment* environment, Object* object)
+{
+    if (!closure_run(closure->operation.operand[0], environment, object)) {
+        return false;
+    } else if (object->type != OBJECT_BOOL) {
+        return evaluate_prefix_operation(OPERATION_NOT, object);
+    }
+    object->boolean = !object->boolean;
+    return true;
+}
+
+/*
+ * Run both operands of an infix operation, and tell whether they are both
+ * integers. Operations on other operands are left to the evaluator.
+ */
+bool closure_operands(const Closure* closure, Environment* environment, Object* object, Object* object_right, bool* integers)
+{
+    if (!closure_run(closure->operation.operand[0], environment, object)) {
+        return false;
+    } else if (!closure_run(closure->operation.operand[1], environment, object_right)) {
+        return false;
+    }
+    *integers = object->type == OBJECT_INTEGER && object_right->type == OBJECT_INTEGER;
+    return true;
+}
+
+bool closure_infix_operation(const Closure* closure, Object* object, Object* object_right)
+{
+    bool result = evaluate_infix_operation(closure->operation.operation, object, object_right);
+    object_free(object_right);
+    return result;
+}
+
+bool closure_add(const Closure* closure, Environment* environment, Object* object)
+{
+    Object object_right;
+    bool integers;
+    if (!closure_operands(closure, environment, object, &object_right, &integers)) {
+        return false;
+    } else if (!integers) {
+        return closure_infix_operation(closure, object, &object_right);
+    }
+    object->integer += object_right.integer;
+    return true;
+}
+
+bool closure_subtract(const Closure* closure, Environment* environment, Object* object)
+{
+    Object object_right;
+    bool integers;
+    if (!closure_operands(closure, environment, object, &object_right, &integers)) {
+        return false;
+    } else if (!integers) {
+        return closure_infix_operation(closure, object, &object_right);
+    }
+    object->integer -= object_right.integer;
+    return true;
+}
+
+bool closure_multiply(const Closure* closure, Environment* environment, Object* object)
+{
+    Object object_right;
+    bool integers;
+    if (!closure_operands(closure, environment, object, &object_right, &integers)) {
+        return false;
+    } else if (!integers) {
+        return closure_infix_operation(closure, object, &object_right);
+    }
+    object->integer *= object_right.integer;
+    return true;
+}
+
+bool closure_divide(const Closure* closure, Environment* environment, Object* object)
+{
+    Object object_right;
+    bool integers;
+    if (!closure_operands(closure, environment, object, &object_right, &integers)) {
+        return false;
+    } else if (!integers) {
+        return closure_infix_operation(closure, object, &object_right);
+    }
+    object->integer /= object_right.integer;
+    return true;
+}
+
+bool closure_less(const Closure* closure, Environment* environment, Object* object)
+{
+    Object object_right;
+    bool integers;
+    if (!closure_operands(closure, environment, object, &object_right, &integers)) {
+        return false;
+    } else if (!integers) {
+        return closure_infix_operation(closure, object, &object_right);
+    }
+    return object_init_bool(object, object->integer < object_right.integer);
+}
+
+bool closure_less_equal(const Closure* closure, Environment* environment, Object* object)
+{
+    Object object_right;
+    bool integers;
+    if (!closure_operands(closure, environment, object, &object_right, &integers)) {
+        return false;
+    } else if (!integers) {
+        return closure_infix_operation(closure, object, &object_right);
+    }
+    return object_init_bool(object, object->integer <= object_right.integer);
+}
+
+bool closure_greater(const Closure* closure, Environment* environment, Object* object)
+{
+    Object object_right;
+    bool integers;
+    if (!closure_operands(closure, environment, object, &object_right, &integers)) {
+        return false;
+    } else if (!integers) {
+        return closure_infix_operation(closure, object, &object_right);
+    }
+    return object_init_bool(object, object->integer > object_right.integer);
+}
+
+bool closure_greater_equal(const Closure* closure, Environment* environment, Object* object)
+{
+    Object object_right;
+    bool integers;
+    if (!closure_operands(closure, environment, object, &object_right, &integers)) {
+        return false;
+    } else if (!integers) {
+        return closure_infix_operation(closure, object, &object_right);
+    }
+    return object_init_bool(object, object->integer >= object_right.integer);
+}
+
+bool closure_equal(const Closure* closure, Environment* environment, Object* object)
+{
+    Object object_right;
+    bool integers;
+    if (!closure_operands(closure, environment, object, &object_right, &integers)) {
+        return false;
+    } else if (!integers) {
+        return closure_infix_operation(closure, object, &object_right);
+    }
+    return object_init_bool(object, object->integer == object_right.integer);
+}
+
+bool closure_not_equal(const Closure* closure, Environment* environment, Object* object)
+{
+    Object object_right;
+    bool integers;
+    if (!closure_operands(closure, environment, object, &object_right, &integers)) {
+        return false;
+    } else if (!integers) {
+        return closure_infix_operation(closure, object, &object_right);
+    }
+    return object_init_bool(object, object->integer != object_right.integer);
+}
+
+bool closure_infix(const Closure* closure, Environment* environment, Object* object)
+{
+    Object object_right;
+    bool integers;
+    if (!closure_operands(closure, environment, object, &object_right, &integers)) {
+        return false;
+    }
+    return closure_infix_operation(closure, object, &object_right);
+}
+
+bool closure_run_statements(const ClosureBlock* block, Environment* environment, Object* object)
+{
+    for (size_t i = 0; i < block->size; ++i) {
+        if (!closure_run(block->statements[i], environment, object)) {
+            return false;
+        } else if (object->returned) {
+            break;
+        } else if (i + 1 < block->size) {
+            object_free(object);
+        }
+    }
+    return true;
+}
+
+bool closure_run_block(const ClosureBlock* block, Environment* environment, Object* object)
+{
+    if (block->scope->size == 0) {
+        return closure_run_statements(block, environment, object);
+    }
+
+    Environment environment_new;
+    environment_init(&environment_new, environment, block->scope);
+    bool result = closure_run_statements(block, &environment_new, object);
+    environment_free(&environment_new);
+    return result;
+}
+
+bool closure_conditional(const Closure* closure, Environment* environment, Object* object)
+{
+    const ClosureConditional* conditional = &closure->conditional;
+    if (!closure_run(conditional->condition, environment, object)) {
+        return false;
+    } else if (object->type != OBJECT_BOOL) {
+        printf("*** EVALUATION ERROR: non-bool result in conditional expression\n");
+        return false;
+    }
+
+    bool result = object->boolean;
+    object_free(object);
+    if (result) {
+        return closure_run_block(conditional->consequence, environment, object);
+    } else if (conditional->alternate != NULL) {
+        return closure_run_block(conditional->alternate, environment, object);
+    }
+    return true;
+}
+
+/*
+ * The parameters of a function occupy the first slots of its environment, and
+ * its arguments are run in the environment of the caller.
+ */
+bool closure_call_arguments(const ClosureCall* call, Environment* environment, const FunctionExpression* function)
+{
+    size_t size = function->parameters_size < call->arguments_size ? function->parameters_size : call->arguments_size;
+    for (size_t i = 0; i < size; ++i) {
+        if (!closure_run(call->arguments[i], environment->next, &environment->objects[i])) {
+            return false;
+        }
+    }
+
+    if (function->parameters_size < call->arguments_size) {
+        printf("*** EVALUATION ERROR: too many arguments in call expression\n");
+        return false;
+    } else if (function->parameters_size > call->arguments_size) {
+        printf("*** EVALUATION ERROR: not enough arguments in call expression\n");
+        return false;
+    }
+    return true;
+}
+
+bool closure_call_function(const ClosureCall* call, Environment* environment, const FunctionExpression* function, Object* object)
+{
+    const ClosureBlock* body = call->program->bodies[function->code];
+    if (body->scope->size == 0) {
+        if (call->arguments_size > 0) {
+            printf("*** EVALUATION ERROR: too many arguments in call expression\n");
+            return false;
+        } else if (!closure_run_statements(body, environment, object)) {
+            return false;
+        }
+        object->returned = false;
+        return true;
+    }
+
+    Environment environment_new;
+    environment_init(&environment_new, environment, body->scope);
+    bool result = closure_call_arguments(call, &environment_new, function) && closure_run_statements(body, &environment_new, object);
+    if (result) {
+        object->returned = false;
+    }
+    environment_free(&environment_new);
+    return result;
+}
+
+bool closure_call_internal(const ClosureCall* call, Environment* environment, const Object* object_fn, Object* object)
+{
+    if (call->arguments_size == 0) {
+        printf("*** EVALUATION ERROR: not enough arguments in call expression\n");
+        return false;
+    } else if (call->arguments_size > 1) {
+        printf("*** EVALUATION ERROR: too many arguments in call expression\n");
+        return false;
+    } else if (!closure_run(call->arguments[0], environment, object)) {
+        return false;
+    }
+    return object_fn->internal(object);
+}
+
+bool closure_call(const Closure* closure, Environment* environment, Object* object)
+{
+    const ClosureCall* call = &closure->call;
+    Object object_fn;
+    bool result = false;
+    if (!closure_run(call->function, environment, &object_fn)) {
+        return false;
+    } else if (object_fn.type == OBJECT_FUNCTION) {
+        result = closure_call_function(call, environment, object_fn.function, object);
+    } else if (object_fn.type == OBJECT_INTERNAL) {
+        result = closure_call_internal(call, environment, &object_fn, object);
+    } else {
+        printf("*** EVALUATION ERROR: non-function object in call expression\n");
+    }
+    object_free(&object_fn);
+    return result;
+}
+
+bool closure_let(const Closure* closure, Environment* environment, Object* object)
+{
+    if (!closure_run(closure->variable.value, environment, object)) {
+        return false;
+    } else if (!environment_insert(environment, &closure->variable.binding, object)) {
+        return false;
+    }
+    object_free(object);
+    return true;
+}
+
+bool closure_return(const Closure* closure, Environment* environment, Object* object)
+{
+    if (!closure_run(closure->variable.value, environment, object)) {
+        return false;
+    }
+    object->returned = true;
+    return true;
+}
+
+bool closure_unexpected_statement(const Closure* closure, Environment* environment, Object* object)
+{
+    (void)closure;
+    (void)environment;
+    (void)object;
+    printf("*** EVALUATION ERROR: unexpected statement type\n");
+    return false;
+}
+
+void closure_program_init(ClosureProgram* program)
+{
+    arena_init(&program->arena);
+    program->bodies = NULL;
+    program->bodies_size = 0;
+    program->bodies_capacity = 0;
+    expression_spine_init(&program->spine);
+}
+
+void closure_program_free(ClosureProgram* program)
+{
+    arena_free(&program->arena);
+    free(program->bodies);
+    expression_spine_free(&program->spine);
+}
+
+Closure* closure_new(ClosureProgram* program, ClosureFunction function)
+{
+    Closure* closure = (Closure*)arena_allocate(&program->arena, sizeof(Closure));
+    closure->function = function;
+    return closure;
+}
+
+ClosureFunction closure_infix_function(Operation operation)
+{
+    switch (operation) {
+    case OPERATION_ADD:
+        return closure_add;
+    case OPERATION_SUBTRACT:
+        return closure_subtract;
+    case OPERATION_MULTIPLY:
+        return closure_multiply;
+    case OPERATION_DIVIDE:
+        return closure_divide;
+    case OPERATION_LESS:
+        return closure_less;
+    case OPERATION_LESS_EQUAL:
+        return closure_less_equal;
+    case OPERATION_GREATER:
+        return closure_greater;
+    case OPERATION_GREATER_EQUAL:
+        return closure_greater_equal;
+    case OPERATION_EQUAL:
+        return closure_equal;
+    case OPERATION_NOT_EQUAL:
+        return closure_not_equal;
+    default:
+        return closure_infix;
+    }
+}
+
+Closure* closure_compile_variable(ClosureProgram* program, const IdentifierExpression* expression)
+{
+    ClosureFunction function = closure_variable;
+    if (expression->binding.type == BINDING_LOCAL && expression->binding.depth == 0) {
+        function = closure_variable_local;
+    } else if (expression->binding.type == BINDING_GLOBAL) {
+        function = closure_variable_global;
+    }
+    Closure* closure = closure_new(program, function);
+    closure->variable.symbol = expression->symbol;
+    closure->variable.binding = expression->binding;
+    closure->variable.value = NULL;
+    return closure;
+}
+
+Closure* closure_compile_prefix(ClosureProgram* program, PrefixExpression* expression)
+{
+    ClosureFunction function = closure_unexpected;
+    if (expression->operation == OPERATION_NEGATIVE) {
+        function = closure_negative;
+    } else if (expression->operation == OPERATION_NOT) {
+        function = closure_not;
+    }
+    Closure* closure = closure_new(program, function);
+    closure->operation.operation = expression->operation;
+    closure->operation.operand[0] = closure_compile_expression(program, expression->operand);
+    closure->operation.operand[1] = NULL;
+    return closure;
+}
+
+/*
+ * Each operation of a chain is compiled around the closure of the chain to its
+ * left.
+ */
+Closure* closure_compile_infix(ClosureProgram* program, Expression* expression)
+{
+    size_t base = program->spine.size;
+    Closure* left = closure_compile_expression(program, expression_spine_push(&program->spine, expression));
+    Expression* infix;
+    while ((infix = expression_spine_pop(&program->spine, base)) != NULL) {
+        Closure* closure = closure_new(program, closure_infix_function(infix->infix.operation));
+        closure->operation.operation = infix->infix.operation;
+        closure->operation.operand[0] = left;
+        closure->operation.operand[1] = closure_compile_expression(program, infix->infix.operand[1]);
+        left = closure;
+    }
+    return left;
+}
+
+Closure* closure_compile_conditional(ClosureProgram* program, ConditionalExpression* expression)
+{
+    Closure* closure = closure_new(program, closure_conditional);
+    closure->conditional.condition = closure_compile_expression(program, expression->condition);
+    closure->conditional.consequence = closure_compile_block(program, expression->consequence);
+    closure->conditional.alternate = expression->alternate == NULL ? NULL : closure_compile_block(program, expression->alternate);
+    return closure;
+}
+
+Closure* closure_compile_function(ClosureProgram* program, FunctionExpression* expression)
+{
+    Closure* closure = closure_new(program, closure_function);
+    closure->literal = expression;
+
+    ClosureBlock* body = closure_compile_block(program, expression->body);
+    if (program->bodies_size >= program->bodies_capacity) {
+        program->bodies_capacity = program->bodies_capacity == 0 ? 8 : 2 * program->bodies_capacity;
+        program->bodies = (ClosureBlock**)realloc(program->bodies, program->bodies_capacity * sizeof(ClosureBlock*));
+    }
+    expression->code = program->bodies_size;
+    program->bodies[program->bodies_size++] = body;
+    return closure;
+}
+
+Closure* closure_compile_call(ClosureProgram* program, CallExpression* expression)
+{
+    Closure* closure = closure_new(program, closure_call);
+    closure->call.function = closure_compile_expression(program, expression->function);
+    closure->call.arguments = (Closure**)arena_allocate(&program->arena, expression->arguments_size * sizeof(Closure*));
+    closure->call.arguments_size = expression->arguments_size;
+    for (size_t i = 0; i < expression->arguments_size; ++i) {
+        closure->call.arguments[i] = closure_compile_expression(program, &expression->arguments[i]);
+    }
+    closure->call.program = program;
+    return closure;
+}
+
+Closure* closure_compile_expression(ClosureProgram* program, Expression* expression)
+{
+    Closure* closure;
+    switch (expression->type) {
+    case EXPRESSION_INTEGER:
+        closure = closure_new(program, closure_integer);
+        closure->integer = expression->integer.value;
+        return closure;
+    case EXPRESSION_BOOL:
+        closure = closure_new(program, closure_bool);
+        closure->boolean = expression->boolean.value;
+        return closure;
+    case EXPRESSION_STRING:
+        closure = closure_new(program, closure_string);
+        closure->string = expression->string.constant;
+        return closure;
+    case EXPRESSION_IDENTIFIER:
+        return closure_compile_variable(program, &expression->identifier);
+    case EXPRESSION_PREFIX:
+        return closure_compile_prefix(program, &expression->prefix);
+    case EXPRESSION_INFIX:
+        return closure_compile_infix(program, expression);
+    case EXPRESSION_CONDITIONAL:
+        return closure_compile_conditional(program, &expression->conditional);
+    case EXPRESSION_FUNCTION:
+        return closure_compile_function(program, &expression->function);
+    case EXPRESSION_CALL:
+        return closure_compile_call(program, &expression->call);
+    default:
+        return closure_new(program, closure_unexpected);
+    }
+}
+
+Closure* closure_compile_statement(ClosureProgram* program, Statement* statement)
+{
+    Closure* closure;
+    switch (statement->type) {
+    case STATEMENT_LET:
+        closure = closure_new(program, closure_let);
+        closure->variable.symbol = statement->identifier;
+        closure->variable.binding = statement->binding;
+        closure->variable.value = closure_compile_expression(program, &statement->expression);
+        return closure;
+    case STATEMENT_RETURN:
+        closure = closure_new(program, closure_return);
+        closure->variable.value = closure_compile_expression(program, &statement->expression);
+        return closure;
+    case STATEMENT_EXPRESSION:
+        return closure_compile_expression(program, &statement->expression);
+    default:
+        return closure_new(program, closure_unexpected_statement);
+    }
+}
+
+ClosureBlock* closure_compile_block(ClosureProgram* program, StatementBlock* block)
+{
+    ClosureBlock* closures = (ClosureBlock*)arena_allocate(&program->arena, sizeof(ClosureBlock));
+    closures->size = 0;
+    for (const Statement* statement = block->head; statement != NULL; statement = statement->next) {
+        closures->size++;
+    }
+    closures->statements = (Closure**)arena_allocate(&program->arena, closures->size * sizeof(Closure*));
+    closures->scope = &block->scope;
+
+    size_t i = 0;
+    for (Statement* statement = block->head; statement != NULL; statement = statement->next) {
+        closures->statements[i++] = closure_compile_statement(program, statement);
+    }
+    return closures;
+}
+
+/*
+ * Compile a resolved program into closures and run them. Function bodies must
+ * already be parsed, since they are compiled ahead of any call.
+ */
+void closure_execute_program(StatementBlock* block)
+{
+    ClosureProgram program;
+    closure_program_init(&program);
+    ClosureBlock* closures = closure_compile_block(&program, block);
+
+    Stack stack;
+    stack_init(&stack);
+
+    Environment environment;
+    evaluate_program_init(&environment, &block->scope, &stack);
+
+    Object object;
+    object.type = OBJECT_NULL;
+    if (closure_run_statements(closures, &environment, &object)) {
+        object_free(&object);
+    }
+    environment_free(&environment);
+    stack_free(&stack);
+    closure_program_free(&program);
+}
@@ -0,0 +1,476 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "monkey/bytecode.h"
+#include "monkey/compiler.h"
+#include "monkey/expression.h"
+#include "monkey/object.h"
+#include "monkey/operation.h"
+#include "monkey/scope.h"
+#include "monkey/statement.h"
+#include "monkey/string.h"
+
+void compiler_init(Compiler* compiler, Bytecode* bytecode)
+{
+    compiler->bytecode = bytecode;
+    compiler->code = bytecode_add_code(bytecode);
+    compiler->bases = NULL;
+    compiler->size = 0;
+    compiler->capacity = 0;
+    compiler->exits = NULL;
+    compiler->exits_size = 0;
+    compiler->exits_capacity = 0;
+    compiler->escaping = false;
+    compiler->escape_locals = 0;
+    expression_spine_init(&compiler->spine);
+}
+
+void compiler_free(const Compiler* compiler)
+{
+    free(compiler->bases);
+    free(compiler->exits);
+    expression_spine_free(&compiler->spine);
+}
+
+Code* compiler_code(Compiler* compiler)
+{
+    return &compiler->bytecode->codes[compiler->code];
+}
+
+bool compile_emit(Compiler* compiler, Opcode opcode)
+{
+    return code_emit(compiler_code(compiler), (uint8_t)opcode);
+}
+
+bool compile_emit_operand(Compiler* compiler, Opcode opcode, size_t operand)
+{
+    if (!compile_emit(compiler, opcode)) {
+        return false;
+    } else if (!code_emit_operand(compiler_code(compiler), operand)) {
+        printf("*** COMPILATION ERROR: instruction operand exceeds limit: %zu\n", operand);
+        return false;
+    }
+    return true;
+}
+
+size_t compile_emit_jump(Compiler* compiler, Opcode opcode)
+{
+    compile_emit_operand(compiler, opcode, 0);
+    return compiler_code(compiler)->size - BYTECODE_OPERAND_SIZE;
+}
+
+bool compile_patch_jump(Compiler* compiler, size_t offset)
+{
+    Code* code = compiler_code(compiler);
+    if (code->size > BYTECODE_OPERAND_MAX) {
+        printf("*** COMPILATION ERROR: function body exceeds size limit\n");
+        return false;
+    }
+    code_patch_operand(code, offset, code->size);
+    return true;
+}
+
+/*
+ * Each scope of a function occupies its own range of slots in the frame of the
+ * function. Ranges are never shared between sibling blocks so that every slot
+ * keeps a single name for dynamic lookups.
+ */
+void compile_push_scope(Compiler* compiler, const Scope* scope)
+{
+    if (compiler->size >= compiler->capacity) {
+        compiler->capacity = compiler->capacity == 0 ? 8 : 2 * compiler->capacity;
+        compiler->bases = (size_t*)realloc(compiler->bases, compiler->capacity * sizeof(size_t));
+    }
+
+    Code* code = compiler_code(compiler);
+    compiler->bases[compiler->size++] = code->locals;
+    for (size_t i = 0; i < scope->size; ++i) {
+        code_add_local(code, scope->names[i]);
+    }
+}
+
+size_t compile_local_slot(const Compiler* compiler, const Binding* binding)
+{
+    return compiler->bases[compiler->size - 1 - binding->depth] + binding->slot;
+}
+
+bool compile_identifier_expression(Compiler* compiler, IdentifierExpression* expression)
+{
+    const Binding* binding = &expression->binding;
+    switch (binding->type) {
+    case BINDING_LOCAL:
+        return compile_emit_operand(compiler, OPCODE_GET_LOCAL, compile_local_slot(compiler, binding));
+    case BINDING_GLOBAL:
+        return compile_emit_operand(compiler, OPCODE_GET_GLOBAL, binding->slot);
+    case BINDING_DYNAMIC:
+        return compile_emit_operand(compiler, OPCODE_GET_NAME, binding->slot);
+    default:
+        printf("*** COMPILATION ERROR: unresolved variable: %s\n", string_value(&expression->symbol->name));
+        return false;
+    }
+}
+
+bool compile_constant(Compiler* compiler, const Object* object)
+{
+    size_t index = bytecode_add_constant(compiler->bytecode, object);
+    return compile_emit_operand(compiler, OPCODE_CONSTANT, index);
+}
+
+bool compile_prefix_expression(Compiler* compiler, PrefixExpression* expression)
+{
+    if (!compile_expression(compiler, expression->operand)) {
+        return false;
+    } else if (expression->operation == OPERATION_NEGATIVE) {
+        return compile_emit(compiler, OPCODE_NEGATIVE);
+    } else if (expression->operation == OPERATION_NOT) {
+        return compile_emit(compiler, OPCODE_NOT);
+    }
+    printf("*** COMPILATION ERROR: unrecognized prefix operation: ");
+    operation_print(expression->operation);
+    putchar('\n');
+    return false;
+}
+
+bool compile_infix_operation(Compiler* compiler, Operation operation)
+{
+    switch (operation) {
+    case OPERATION_EQUAL:
+        return compile_emit(compiler, OPCODE_EQUAL);
+    case OPERATION_NOT_EQUAL:
+        return compile_emit(compiler, OPCODE_NOT_EQUAL);
+    case OPERATION_GREATER:
+        return compile_emit(compiler, OPCODE_GREATER);
+    case OPERATION_GREATER_EQUAL:
+        return compile_emit(compiler, OPCODE_GREATER_EQUAL);
+    case OPERATION_LESS:
+        return compile_emit(compiler, OPCODE_LESS);
+    case OPERATION_LESS_EQUAL:
+        return compile_emit(compiler, OPCODE_LESS_EQUAL);
+    case OPERATION_ADD:
+        return compile_emit(compiler, OPCODE_ADD);
+    case OPERATION_SUBTRACT:
+        return compile_emit(compiler, OPCODE_SUBTRACT);
+    case OPERATION_MULTIPLY:
+        return compile_emit(compiler, OPCODE_MULTIPLY);
+    case OPERATION_DIVIDE:
+        return compile_emit(compiler, OPCODE_DIVIDE);
+    default:
+        printf("*** COMPILATION ERROR: unrecognized infix operation: ");
+        operation_print(operation);
+        putchar('\n');
+        return false;
+    }
+}
+
+bool compile_infix_expression(Compiler* compiler, Expression* expression)
+{
+    size_t base = compiler->spine.size;
+    bool result = compile_expression(compiler, expression_spine_push(&compiler->spine, expression));
+    Expression* infix;
+    while ((infix = expression_spine_pop(&compiler->spine, base)) != NULL) {
+        result = result && compile_expression(compiler, infix->infix.operand[1])
+            && compile_infix_operation(compiler, infix->infix.operation);
+    }
+    return result;
+}
+
+/*
+ * Compile the statements of a block so that exactly one value remains on the
+ * stack afterwards: the value of the last statement, or null if the block is
+ * empty or ends with a let statement.
+ */
+bool compile_statements(Compiler* compiler, StatementBlock* block)
+{
+    if (block->head == NULL) {
+        return compile_emit(compiler, OPCODE_NULL);
+    }
+
+    for (Statement* statement = block->head; statement != NULL; statement = statement->next) {
+        if (!compile_statement(compiler, statement)) {
+            return false;
+        } else if (statement->type == STATEMENT_LET && statement->next == NULL) {
+            compile_emit(compiler, OPCODE_NULL);
+        } else if (statement->type == STATEMENT_EXPRESSION && statement->next != NULL) {
+            compile_emit(compiler, OPCODE_POP);
+        }
+    }
+    return true;
+}
+
+bool compile_block(Compiler* compiler, StatementBlock* block)
+{
+    if (block->scope.size == 0) {
+        return compile_statements(compiler, block);
+    }
+
+    compile_push_scope(compiler, &block->scope);
+    bool result = compile_statements(compiler, block);
+    size_t base = compiler->bases[--compiler->size];
+
+    // variables declared in the block go out of scope
+    for (size_t i = 0; result && i < block->scope.size; ++i) {
+        result = compile_emit_operand(compiler, OPCODE_UNSET_LOCAL, base + i);
+    }
+    return result;
+}
+
+bool compile_conditional_expression(Compiler* compiler, ConditionalExpression* expression)
+{
+    if (!compile_expression(compiler, expression->condition)) {
+        return false;
+    }
+
+    size_t jump_alternate = compile_emit_jump(compiler, OPCODE_JUMP_FALSE);
+    if (!compile_block(compiler, expression->consequence)) {
+        return false;
+    }
+
+    size_t jump_end = compile_emit_jump(compiler, OPCODE_JUMP);
+    if (!compile_patch_jump(compiler, jump_alternate)) {
+        return false;
+    } else if (expression->alternate == NULL) {
+        compile_emit(compiler, OPCODE_NULL);
+    } else if (!compile_block(compiler, expression->alternate)) {
+        return false;
+    }
+
+    return compile_patch_jump(compiler, jump_end);
+}
+
+/*
+ * Compile a conditional expression whose value is used by an expression or a
+ * let statement, which is where the returns within its blocks end.
+ */
+bool compile_escape_expression(Compiler* compiler, ConditionalExpression* expression)
+{
+    bool escaping = compiler->escaping;
+    size_t escape_locals = compiler->escape_locals;
+    size_t base = compiler->exits_size;
+    compiler->escaping = true;
+    compiler->escape_locals = compiler_code(compiler)->locals;
+
+    bool result = compile_conditional_expression(compiler, expression);
+    while (compiler->exits_size > base) {
+        size_t offset = compiler->exits[--compiler->exits_size];
+        result = result && compile_patch_jump(compiler, offset);
+    }
+
+    compiler->escaping = escaping;
+    compiler->escape_locals = escape_locals;
+    return result;
+}
+
+bool compile_function_expression(Compiler* compiler, FunctionExpression* expression)
+{
+    Compiler compiler_function;
+    compiler_init(&compiler_function, compiler->bytecode);
+    expression->code = compiler_function.code;
+
+    // parameters occupy the first slots of the scope of the body
+    compile_push_scope(&compiler_function, &expression->body->scope);
+    compiler_code(&compiler_function)->parameters = expression->parameters_size;
+
+    bool result = compile_statements(&compiler_function, expression->body)
+        && compile_emit(&compiler_function, OPCODE_RETURN);
+    compiler_free(&compiler_function);
+    if (!result) {
+        return false;
+    }
+
+    Object object;
+    object_init_function(&object, expression);
+    return compile_constant(compiler, &object);
+}
+
+/*
+ * Each argument is preceded by a check that the function accepts it, so that
+ * an argument is only evaluated if the call can still succeed, as in the
+ * evaluator.
+ */
+bool compile_call_expression(Compiler* compiler, CallExpression* expression)
+{
+    size_t count = expression->arguments_size;
+    if (count > BYTECODE_ARGUMENTS_MAX) {
+        printf("*** COMPILATION ERROR: too many arguments in call expression\n");
+        return false;
+    } else if (!compile_expression(compiler, expression->function)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        compile_emit(compiler, OPCODE_ARGUMENT);
+        code_emit(compiler_code(compiler), (uint8_t)i);
+        code_emit(compiler_code(compiler), (uint8_t)count);
+        if (!compile_expression(compiler, &expression->arguments[i])) {
+            return false;
+        }
+    }
+
+    compile_emit(compiler, OPCODE_CALL);
+    return code_emit(compiler_code(compiler), (uint8_t)count);
+}
+
+bool compile_integer_expression(Compiler* compiler, IntegerExpression* expression)
+{
+    Object object;
+    object_init_integer(&object, expression->value);
+    return compile_constant(compiler, &object);
+}
+
+bool compile_string_expression(Compiler* compiler, StringExpression* expression)
+{
+    Object object;
+    object_init_string_constant(&object, expression->constant);
+    bool result = compile_constant(compiler, &object);
+    object_free(&object);
+    return result;
+}
+
+bool compile_expression(Compiler* compiler, Expression* expression)
+{
+    switch (expression->type) {
+    case EXPRESSION_IDENTIFIER:
+        return compile_identifier_expression(compiler, &expression->identifier);
+    case EXPRESSION_INTEGER:
+        return compile_integer_expression(compiler, &expression->integer);
+    case EXPRESSION_STRING:
+        return compile_string_expression(compiler, &expression->string);
+    case EXPRESSION_BOOL:
+        return compile_emit(compiler, expression->boolean.value ? OPCODE_TRUE : OPCODE_FALSE);
+    case EXPRESSION_PREFIX:
+        return compile_prefix_expression(compiler, &expression->prefix);
+    case EXPRESSION_INFIX:
+        return compile_infix_expression(compiler, expression);
+    case EXPRESSION_CONDITIONAL:
+        return compile_escape_expression(compiler, &expression->conditional);
+    case EXPRESSION_FUNCTION:
+        return compile_function_expression(compiler, &expression->function);
+    case EXPRESSION_CALL:
+        return compile_call_expression(compiler, &expression->call);
+    default:
+        printf("*** COMPILATION ERROR: unexpected expression type\n");
+        return false;
+    }
+}
+
+/*
+ * The value of a conditional expression that is the value of a statement is
+ * the value of the statement, so the returns within it leave the block of the
+ * statement as well.
+ */
+bool compile_statement_expression(Compiler* compiler, Expression* expression)
+{
+    if (expression->type == EXPRESSION_CONDITIONAL) {
+        return compile_conditional_expression(compiler, &expression->conditional);
+    }
+    return compile_expression(compiler, expression);
+}
+
+/*
+ * Leave the blocks up to the end of the conditional expression whose value is
+ * on top of the stack.
+ */
+bool compile_escape(Compiler* compiler)
+{
+    for (size_t i = compiler->escape_locals; i < compiler_code(compiler)->locals; ++i) {
+        if (!compile_emit_operand(compiler, OPCODE_UNSET_LOCAL, i)) {
+            return false;
+        }
+    }
+    if (compiler->exits_size >= compiler->exits_capacity) {
+        compiler->exits_capacity = compiler->exits_capacity == 0 ? 8 : 2 * compiler->exits_capacity;
+        compiler->exits = (size_t*)realloc(compiler->exits, compiler->exits_capacity * sizeof(size_t));
+    }
+    compiler->exits[compiler->exits_size++] = compile_emit_jump(compiler, OPCODE_JUMP);
+    return true;
+}
+
+/*
+ * A return that stops short of the function marks its value as returned.
+ */
+bool compile_return_statement(Compiler* compiler, Statement* statement)
+{
+    if (!compile_statement_expression(compiler, &statement->expression)) {
+        return false;
+    } else if (!compiler->escaping) {
+        return compile_emit(compiler, OPCODE_RETURN);
+    }
+    return compile_emit(compiler, OPCODE_MARK_RETURN) && compile_escape(compiler);
+}
+
+/*
+ * Prefix and arithmetic operations keep the mark of their left operand, as
+ * they do when evaluated, so an expression statement whose left operands lead
+ * to a conditional expression may have a marked value. The statement then
+ * returns it as a return statement would.
+ */
+bool compile_statement_marked(const Expression* expression)
+{
+    if (expression->type == EXPRESSION_CONDITIONAL) {
+        // the returns within it are those of the statement
+        return false;
+    }
+    while (true) {
+        if (expression->type == EXPRESSION_PREFIX) {
+            expression = expression->prefix.operand;
+        } else if (expression->type == EXPRESSION_INFIX && operation_precedence(expression->infix.operation) >= PRECEDENCE_SUM) {
+            expression = expression->infix.operand[0];
+        } else {
+            return expression->type == EXPRESSION_CONDITIONAL;
+        }
+    }
+}
+
+bool compile_marked_statement(Compiler* compiler)
+{
+    size_t jump = compile_emit_jump(compiler, OPCODE_JUMP_UNMARKED);
+    bool result = compiler->escaping ? compile_escape(compiler) : compile_emit(compiler, OPCODE_RETURN);
+    return result && compile_patch_jump(compiler, jump);
+}
+
+bool compile_expression_statement(Compiler* compiler, Statement* statement)
+{
+    if (!compile_statement_expression(compiler, &statement->expression)) {
+        return false;
+    } else if (compile_statement_marked(&statement->expression)) {
+        return compile_marked_statement(compiler);
+    }
+    return true;
+}
+
+bool compile_let_statement(Compiler* compiler, Statement* statement)
+{
+    if (!compile_expression(compiler, &statement->expression)) {
+        return false;
+    } else if (statement->binding.type == BINDING_GLOBAL) {
+        return compile_emit_operand(compiler, OPCODE_SET_GLOBAL, statement->binding.slot);
+    }
+    return compile_emit_operand(compiler, OPCODE_SET_LOCAL, compile_local_slot(compiler, &statement->binding));
+}
+
+bool compile_statement(Compiler* compiler, Statement* statement)
+{
+    switch (statement->type) {
+    case STATEMENT_LET:
+        return compile_let_statement(compiler, statement);
+    case STATEMENT_RETURN:
+        return compile_return_statement(compiler, statement);
+    case STATEMENT_EXPRESSION:
+        return compile_expression_statement(compiler, statement);
+    default:
+        printf("*** COMPILATION ERROR: unexpected statement type\n");
+        return false;
+    }
+}
+
+bool compile_program(Bytecode* bytecode, StatementBlock* block)
+{
+    bytecode->globals = &block->scope;
+
+    Compiler compiler;
+    compiler_init(&compiler, bytecode);
+    bool result = compile_statements(&compiler, block) && compile_emit(&compiler, OPCODE_RETURN);
+    compiler_free(&compiler);
+    return result;
+}
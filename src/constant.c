@@ -0,0 +1,54 @@
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "monkey/constant.h"
+#include "monkey/hash.h"
+#include "monkey/object.h"
+#include "monkey/string.h"
+
+void constant_pool_init(ConstantPool* pool)
+{
+    hash_init(&pool->strings);
+    pthread_mutex_init(&pool->mutex, NULL);
+}
+
+void constant_pool_release(void* value)
+{
+    object_string_release((ObjectString*)value);
+}
+
+void constant_pool_free(ConstantPool* pool)
+{
+    hash_free(&pool->strings, constant_pool_release);
+    pthread_mutex_destroy(&pool->mutex);
+}
+
+/*
+ * Intern a string given by its characters and length, such as the lexeme of a
+ * string token. Chunks of a program may be parsed concurrently, so interning
+ * is serialized.
+ */
+ObjectString* constant_pool_string(ConstantPool* pool, const char* characters, size_t length)
+{
+    uint64_t hash = hash_key_span(characters, length);
+    pthread_mutex_lock(&pool->mutex);
+    ObjectString* string = (ObjectString*)hash_retrieve_span(&pool->strings, characters, length, hash);
+    if (string != NULL) {
+        pthread_mutex_unlock(&pool->mutex);
+        return string;
+    }
+
+    string = (ObjectString*)malloc(sizeof(ObjectString));
+    string->references = 1;
+    string->length = length;
+    string->left = NULL;
+    string->right = NULL;
+    string_init(&string->value);
+    string_reserve(&string->value, 1);
+    string_extend(&string->value, characters, length);
+
+    // the characters stay in place since the strings of the pool are never moved
+    hash_insert_hash(&pool->strings, string_value(&string->value), hash, string);
+    pthread_mutex_unlock(&pool->mutex);
+    return string;
+}
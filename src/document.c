@@ -0,0 +1,262 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "monkey/document.h"
+#include "monkey/lexer.h"
+#include "monkey/parser.h"
+
+/*
+ * Statements that are replaced by an edit are freed, but the memory of their
+ * trees stays in the arena of the document. Once there are more of them than
+ * there are live statements, the whole document is parsed again into a new
+ * arena.
+ */
+#define DOCUMENT_GARBAGE_MIN 1024
+
+void document_statements_reserve(Document* document, size_t size)
+{
+    if (size > document->statements_capacity) {
+        size_t capacity = document->statements_capacity == 0 ? 64 : document->statements_capacity;
+        while (capacity < size) {
+            capacity *= 2;
+        }
+        document->statements = (DocumentStatement*)realloc(document->statements, capacity * sizeof(DocumentStatement));
+        document->statements_capacity = capacity;
+    }
+}
+
+/*
+ * The offset of a token in the source. The lexeme of a string excludes its
+ * opening quote.
+ */
+size_t document_token_offset(const Document* document, const Token* token)
+{
+    size_t offset = (size_t)(token->lexeme - document->source);
+    return token->type == TOKEN_STRING ? offset - 1 : offset;
+}
+
+/*
+ * The index of the statement whose extent, from its first token up to the
+ * first token of the next statement, holds the offset. Whatever precedes the
+ * first statement belongs to it.
+ */
+size_t document_find(const Document* document, size_t offset)
+{
+    size_t low = 0;
+    size_t high = document->statements_size;
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if (document->statements[middle].start <= offset) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/*
+ * Parse the source from the statement at index first, replacing the statements
+ * from there on until the parse reaches the first token of one of the
+ * statements from index reuse on, which are unchanged and are kept along with
+ * all the statements following them. If parsing fails, all the statements from
+ * index first on are replaced by those parsed before the error.
+ */
+bool document_parse(Document* document, size_t first, size_t reuse)
+{
+    LexerRange range = { 0, document->size, 0, -1 };
+    if (first > 0) {
+        const DocumentStatement* statement = &document->statements[first];
+        range.start = statement->start;
+        range.line = statement->line;
+        range.line_offset = statement->line_offset;
+    }
+
+    Parser parser;
+    parser_init_buffer(&parser, document->source, &range);
+    parser.arena = document->arena;
+    parser.constants = &document->constants;
+    error_init(&document->error);
+
+    DocumentStatement* parsed = NULL;
+    size_t parsed_size = 0;
+    size_t parsed_capacity = 0;
+    bool result = true;
+    while (true) {
+        const Token* token = parser_peek(&parser);
+        if (token->type == TOKEN_END) {
+            reuse = document->statements_size;
+            break;
+        }
+        size_t start = document_token_offset(document, token);
+        while (reuse < document->statements_size && document->statements[reuse].start < start) {
+            reuse++;
+        }
+        if (reuse < document->statements_size && document->statements[reuse].start == start) {
+            break;
+        }
+
+        if (parsed_size == parsed_capacity) {
+            parsed_capacity = parsed_capacity == 0 ? 16 : 2 * parsed_capacity;
+            parsed = (DocumentStatement*)realloc(parsed, parsed_capacity * sizeof(DocumentStatement));
+        }
+        DocumentStatement* statement = &parsed[parsed_size];
+        statement->start = start;
+        statement->line = token->line;
+        statement->line_offset = (ssize_t)start - token->position;
+
+        Statement statement_parsed;
+        if (!parser_parse_program_next(&parser, &statement_parsed)) {
+            document->error = parser.error;
+            reuse = document->statements_size;
+            result = false;
+            break;
+        }
+        statement->statement = (Statement*)arena_allocate(&parser.arena, sizeof(Statement));
+        *statement->statement = statement_parsed;
+        statement->statement->next = NULL;
+        statement->terminated = parser.token.type == TOKEN_SEMICOLON;
+        parsed_size++;
+    }
+    document->arena = parser.arena;
+
+    for (size_t i = first; i < reuse; ++i) {
+        statement_free(document->statements[i].statement);
+    }
+    document->garbage += reuse - first;
+
+    Statement* previous = first > 0 ? document->statements[first - 1].statement : NULL;
+    Statement* next = reuse < document->statements_size ? document->statements[reuse].statement : NULL;
+    for (size_t i = 0; i < parsed_size; ++i) {
+        if (previous == NULL) {
+            document->program.head = parsed[i].statement;
+        } else {
+            previous->next = parsed[i].statement;
+        }
+        previous = parsed[i].statement;
+    }
+    if (previous == NULL) {
+        document->program.head = next;
+    } else {
+        previous->next = next;
+    }
+    if (next == NULL) {
+        document->program.tail = previous;
+    }
+
+    size_t size = document->statements_size - reuse + first + parsed_size;
+    document_statements_reserve(document, size);
+    memmove(document->statements + first + parsed_size, document->statements + reuse, (document->statements_size - reuse) * sizeof(DocumentStatement));
+    if (parsed_size > 0) {
+        memcpy(document->statements + first, parsed, parsed_size * sizeof(DocumentStatement));
+    }
+    document->statements_size = size;
+    free(parsed);
+    return result;
+}
+
+/*
+ * Parse the whole source into a new arena.
+ */
+bool document_parse_all(Document* document)
+{
+    statement_block_free(&document->program);
+    arena_free(&document->arena);
+    statement_block_init(&document->program);
+    document->statements_size = 0;
+    document->garbage = 0;
+    return document_parse(document, 0, 0);
+}
+
+bool document_init(Document* document, const char* source, size_t size)
+{
+    document->capacity = size == 0 ? 1 : size;
+    document->source = (char*)malloc(document->capacity);
+    memcpy(document->source, source, size);
+    document->size = size;
+    arena_init(&document->arena);
+    constant_pool_init(&document->constants);
+    statement_block_init(&document->program);
+    document->statements = NULL;
+    document->statements_size = 0;
+    document->statements_capacity = 0;
+    document->garbage = 0;
+    error_init(&document->error);
+    return document_parse(document, 0, 0);
+}
+
+void document_free(Document* document)
+{
+    statement_block_free(&document->program);
+    arena_free(&document->arena);
+    constant_pool_free(&document->constants);
+    free(document->statements);
+    free(document->source);
+}
+
+size_t document_count_lines(const char* text, size_t size)
+{
+    size_t lines = 0;
+    for (const char* end = text + size; (text = memchr(text, '\n', (size_t)(end - text))) != NULL; ++text) {
+        lines++;
+    }
+    return lines;
+}
+
+/*
+ * Replace length characters of the source at offset by the given text, and
+ * parse again the statements the edit touches. A statement not ended by a
+ * semicolon is parsed again along with the statement following it, since its
+ * extent depends on the first token of that statement. The statements that
+ * start after the edit are moved along with the text, and are reused as soon
+ * as the parse reaches one of them. After an edit that leaves the program with
+ * an error, the next edit parses the whole source again.
+ */
+bool document_edit(Document* document, size_t offset, size_t length, const char* text, size_t text_length)
+{
+    if (offset > document->size || length > document->size - offset) {
+        return false;
+    }
+
+    size_t end = offset + length;
+    size_t first = document_find(document, offset);
+    if (first > 0 && !document->statements[first - 1].terminated) {
+        first--;
+    }
+    size_t reuse = document->statements_size == 0 ? 0 : document_find(document, end) + 1;
+    ssize_t lines = (ssize_t)document_count_lines(text, text_length) - (ssize_t)document_count_lines(document->source + offset, length);
+
+    size_t size = document->size - length + text_length;
+    if (size > document->capacity) {
+        while (document->capacity < size) {
+            document->capacity *= 2;
+        }
+        document->source = (char*)realloc(document->source, document->capacity);
+    }
+    memmove(document->source + offset + text_length, document->source + end, document->size - end);
+    memcpy(document->source + offset, text, text_length);
+    document->size = size;
+
+    // the start of the line holding the end of the edit, for the statements on it
+    ssize_t line_offset = (ssize_t)(offset + text_length);
+    while (line_offset > 0 && document->source[line_offset - 1] != '\n') {
+        line_offset--;
+    }
+    if (line_offset == 0) {
+        line_offset = -1;
+    }
+
+    ssize_t delta = (ssize_t)text_length - (ssize_t)length;
+    for (size_t i = reuse; i < document->statements_size; ++i) {
+        DocumentStatement* statement = &document->statements[i];
+        statement->start += delta;
+        statement->line += lines;
+        statement->line_offset = statement->line_offset > (ssize_t)end ? statement->line_offset + delta : line_offset;
+    }
+
+    if (document->error.type != ERROR_NONE || document->garbage > document->statements_size + DOCUMENT_GARBAGE_MIN) {
+        return document_parse_all(document);
+    }
+    return document_parse(document, first, reuse);
+}
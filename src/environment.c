@@ -2,56 +2,134 @@
 #include <stdlib.h>
 
 #include "monkey/environment.h"
-#include "monkey/hash.h"
 #include "monkey/object.h"
+#include "monkey/scope.h"
+#include "monkey/stack.h"
+#include "monkey/symbol.h"
 
-void environment_init(Environment* environment, Environment* environment_next)
+void environment_init_objects(Environment* environment, size_t start)
 {
-    hash_init(&environment->table);
+    for (size_t i = start; i < environment->size; ++i) {
+        environment->objects[i].type = OBJECT_NONE;
+        environment->objects[i].returned = false;
+    }
+}
+
+/*
+ * Take one slot for each name in the scope from the stack shared by all
+ * environments of the program. Slots are unbound until the corresponding let
+ * statement or parameter assigns them.
+ */
+void environment_init(Environment* environment, Environment* environment_next, const Scope* scope)
+{
+    environment->scope = scope;
     environment->next = environment_next;
+    environment->global = environment_next->global;
+    environment->stack = environment_next->stack;
+    environment->objects = stack_push(environment->stack, scope->size);
+    environment->size = scope->size;
+    environment_init_objects(environment, 0);
 }
 
-void environment_free_aux(void* object)
+/*
+ * The slots of the global environment are allocated separately since they
+ * outlive every other environment.
+ */
+void environment_init_global(Environment* environment, const Scope* scope, Stack* stack)
 {
-    object_free((Object*)object);
-    free(object);
+    environment->scope = scope;
+    environment->next = NULL;
+    environment->global = environment;
+    environment->stack = stack;
+    environment->objects = (Object*)malloc(scope->size * sizeof(Object));
+    environment->size = scope->size;
+    environment_init_objects(environment, 0);
 }
 
-void environment_free(Environment* environment)
+/*
+ * Add slots to the global environment for names added to its scope since it
+ * was set up, as happens when a program is resolved one statement at a time.
+ */
+void environment_extend(Environment* environment)
 {
-    hash_free(&environment->table, environment_free_aux);
+    size_t size = environment->size;
+    if (environment->scope->size > size) {
+        environment->objects = (Object*)realloc(environment->objects, environment->scope->size * sizeof(Object));
+        environment->size = environment->scope->size;
+        environment_init_objects(environment, size);
+    }
 }
 
-bool environment_insert(Environment* environment, const String* string, const Object* source)
+void environment_free(Environment* environment)
 {
-    Object* object = (Object*)hash_retrieve(&environment->table, string->value);
-    if (object == NULL) {
-        object = (Object*)malloc(sizeof(Object));
-        object_copy(object, source);
-        hash_insert(&environment->table, string->value, object);
+    for (size_t i = 0; i < environment->size; ++i) {
+        object_free(&environment->objects[i]);
+    }
+    if (environment->next == NULL) {
+        free(environment->objects);
     } else {
-        object_free(object);
-        object_copy(object, source);
+        stack_pop(environment->stack, environment->size);
     }
-    return true;
 }
 
-bool environment_retrieve_aux(const Environment* environment, const String* string, Object* destination)
+Object* environment_locate(const Environment* environment, const Binding* binding)
 {
-    Object* object = (Object*)hash_retrieve(&environment->table, string->value);
-    if (object != NULL) {
-        object_copy(destination, object);
-        return true;
+    if (binding->type == BINDING_GLOBAL) {
+        return &environment->global->objects[binding->slot];
     }
-    return false;
+    for (size_t i = 0; i < binding->depth; ++i) {
+        environment = environment->next;
+    }
+    return &environment->objects[binding->slot];
+}
+
+bool environment_insert(Environment* environment, const Binding* binding, const Object* source)
+{
+    Object* object = environment_locate(environment, binding);
+    object_free(object);
+    return object_copy(object, source);
 }
 
-bool environment_retrieve(const Environment* environment, const String* string, Object* destination)
+/*
+ * Search the chain of environments for the innermost bound slot with the name
+ * of the global slot of a dynamic binding. The global environment is indexed
+ * directly, since the resolver assigns a global slot to every free name.
+ */
+const Object* environment_retrieve_dynamic(const Environment* environment, const Binding* binding)
 {
-    for (; environment != NULL; environment = environment->next) {
-        if (environment_retrieve_aux(environment, string, destination)) {
-            return true;
+    const Environment* global = environment->global;
+    const Symbol* name = global->scope->names[binding->slot];
+
+    for (; environment != global; environment = environment->next) {
+        for (size_t i = environment->scope->size; i > 0; --i) {
+            const Object* object = &environment->objects[i - 1];
+            if (object->type != OBJECT_NONE && environment->scope->names[i - 1] == name) {
+                return object;
+            }
         }
     }
-    return false;
+    return &global->objects[binding->slot];
+}
+
+/*
+ * The object held by the slot of a binding, or NULL if the slot is unbound.
+ */
+const Object* environment_lookup(const Environment* environment, const Binding* binding)
+{
+    const Object* object;
+    if (binding->type == BINDING_DYNAMIC) {
+        object = environment_retrieve_dynamic(environment, binding);
+    } else {
+        object = environment_locate(environment, binding);
+    }
+    return object->type == OBJECT_NONE ? NULL : object;
+}
+
+bool environment_retrieve(const Environment* environment, const Binding* binding, Object* destination)
+{
+    const Object* object = environment_lookup(environment, binding);
+    if (object == NULL) {
+        return false;
+    }
+    return object_copy(destination, object);
 }
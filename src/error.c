@@ -10,11 +10,6 @@ void error_init(Error* error)
     token_init(&error->token, 0, 0);
 }
 
-void error_free(const Error* error)
-{
-    token_free(&error->token);
-}
-
 void error_print(const Error* error)
 {
     printf("%zu:%zd: ", error->token.line, error->token.position);
@@ -22,16 +17,16 @@ void error_print(const Error* error)
     case ERROR_NONE:
         break;
     case ERROR_LET_TOKEN_ASSIGN:
-        printf("expected assignment op in let statement: %s", error->token.lexeme.value);
+        printf("expected assignment op in let statement: %.*s", (int)error->token.length, error->token.lexeme);
         break;
     case ERROR_LET_TOKEN_IDENTIFIER:
-        printf("expected identifier in let statement: %s", error->token.lexeme.value);
+        printf("expected identifier in let statement: %.*s", (int)error->token.length, error->token.lexeme);
         break;
     case ERROR_TOKEN_ILLEGAL:
-        printf("unrecognized token: %s\n", error->token.lexeme.value);
+        printf("unrecognized token: %.*s\n", (int)error->token.length, error->token.lexeme);
         break;
     case ERROR_TOKEN_UNEXPECTED:
-        printf("unexpected token: %s\n", error->token.lexeme.value);
+        printf("unexpected token: %.*s\n", (int)error->token.length, error->token.lexeme);
         break;
     case ERROR_EXPRESSION_GROUP_EXPECTED_PAREN:
         printf("expected closing parenthesis in grouped expression\n");
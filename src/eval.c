@@ -2,20 +2,70 @@
 #include <stdlib.h>
 
 #include "monkey/environment.h"
+#include "monkey/error.h"
 #include "monkey/eval.h"
 #include "monkey/expression.h"
 #include "monkey/functions.h"
-#include "monkey/hash.h"
 #include "monkey/object.h"
+#include "monkey/parser.h"
+#include "monkey/resolver.h"
+#include "monkey/scope.h"
+#include "monkey/stack.h"
 #include "monkey/statement.h"
+#include "monkey/symbol.h"
+
+/*
+ * Identifiers, operations and calls observe the types they are evaluated with.
+ * Once they have been evaluated with the same types a number of times in a
+ * row, they are rewritten in place into a specialized expression, which
+ * guards its assumption on every evaluation. When the guard fails, the
+ * expression reverts to its general form for good.
+ */
+#define EVALUATE_OBSERVED_MIN 8
+#define EVALUATE_OBSERVED_NEVER 255
+
+/*
+ * Count an evaluation with the types a specialized expression assumes, and
+ * tell whether the expression is now to be specialized.
+ */
+bool evaluate_observe(unsigned char* observed, bool expected)
+{
+    if (*observed == EVALUATE_OBSERVED_NEVER) {
+        return false;
+    } else if (!expected) {
+        *observed = 0;
+        return false;
+    }
+    return ++*observed >= EVALUATE_OBSERVED_MIN;
+}
+
+void evaluate_revert(Expression* expression, ExpressionType type, unsigned char* observed)
+{
+    expression->type = type;
+    *observed = EVALUATE_OBSERVED_NEVER;
+}
 
-bool evaluate_identifier_expression(Environment* environment, IdentifierExpression* expression, Object* object)
+bool evaluate_identifier_expression(Environment* environment, Expression* expression, Object* object)
 {
-    if (!environment_retrieve(environment, &expression->value, object)) {
-        printf("*** EVALUATION ERROR: missing variable: %s\n", expression->value.value);
+    IdentifierExpression* identifier = &expression->identifier;
+    const Object* value = environment_lookup(environment, &identifier->binding);
+    if (value == NULL) {
+        printf("*** EVALUATION ERROR: missing variable: %s\n", string_value(&identifier->symbol->name));
         return false;
+    } else if (evaluate_observe(&identifier->observed, value->type == OBJECT_INTEGER)) {
+        expression->type = EXPRESSION_IDENTIFIER_INTEGER;
     }
-    return true;
+    return object_copy(object, value);
+}
+
+bool evaluate_identifier_integer_expression(Environment* environment, Expression* expression, Object* object)
+{
+    const Object* value = environment_lookup(environment, &expression->identifier.binding);
+    if (value == NULL || value->type != OBJECT_INTEGER) {
+        evaluate_revert(expression, EXPRESSION_IDENTIFIER, &expression->identifier.observed);
+        return evaluate_identifier_expression(environment, expression, object);
+    }
+    return object_init_integer(object, value->integer);
 }
 
 bool evaluate_prefix_negative_operation(Object* object)
@@ -38,21 +88,33 @@ bool evaluate_prefix_not_operation(Object* object)
     return true;
 }
 
-bool evaluate_prefix_expression(Environment* environment, PrefixExpression* expression, Object* object)
+bool evaluate_prefix_operation(Operation operation, Object* object)
 {
-    if (!evaluate_expression(environment, expression->operand, object)) {
-        return false;
-    } else if (expression->operation == OPERATION_NEGATIVE) {
+    if (operation == OPERATION_NEGATIVE) {
         return evaluate_prefix_negative_operation(object);
-    } else if (expression->operation == OPERATION_NOT) {
+    } else if (operation == OPERATION_NOT) {
         return evaluate_prefix_not_operation(object);
     }
     printf("*** EVALUATION ERROR: unrecognized prefix operation: ");
-    operation_print(expression->operation);
+    operation_print(operation);
     putchar('\n');
     return false;
 }
 
+bool evaluate_prefix_expression(Environment* environment, PrefixExpression* expression, Object* object)
+{
+    if (!evaluate_expression(environment, expression->operand, object)) {
+        return false;
+    } else if (!expression->typed) {
+        return evaluate_prefix_operation(expression->operation, object);
+    } else if (expression->operation == OPERATION_NEGATIVE) {
+        object->integer *= -1;
+    } else {
+        object->boolean = !object->boolean;
+    }
+    return true;
+}
+
 bool evaluate_infix_comparison_operation(Operation operation, Object* object, Object* object_right)
 {
     bool result = object_equal(object, object_right);
@@ -118,7 +180,7 @@ bool evaluate_infix_arithmetic_operation(Operation operation, Object* object, Ob
             putchar('\n');
             return false;
         }
-        return string_concatenate(object->string, object_right->string);
+        return object_string_concatenate(object, object_right);
     }
 
     if (object->type != OBJECT_INTEGER) {
@@ -145,39 +207,106 @@ bool evaluate_infix_arithmetic_operation(Operation operation, Object* object, Ob
     return true;
 }
 
-bool evaluate_infix_expression_aux(Environment* environment, InfixExpression* expression, Object* object, Object* object_right)
+bool evaluate_infix_operation(Operation operation, Object* object, Object* object_right)
 {
-    switch (expression->operation) {
+    switch (operation) {
     case OPERATION_EQUAL:
     case OPERATION_NOT_EQUAL:
-        return evaluate_infix_comparison_operation(expression->operation, object, object_right);
+        return evaluate_infix_comparison_operation(operation, object, object_right);
     case OPERATION_GREATER:
     case OPERATION_GREATER_EQUAL:
     case OPERATION_LESS:
     case OPERATION_LESS_EQUAL:
-        return evaluate_infix_inequality_operation(expression->operation, object, object_right);
+        return evaluate_infix_inequality_operation(operation, object, object_right);
     case OPERATION_ADD:
     case OPERATION_SUBTRACT:
     case OPERATION_MULTIPLY:
     case OPERATION_DIVIDE:
-        return evaluate_infix_arithmetic_operation(expression->operation, object, object_right);
+        return evaluate_infix_arithmetic_operation(operation, object, object_right);
     default:
         return false;
     }
 }
 
-bool evaluate_infix_expression(Environment* environment, InfixExpression* expression, Object* object)
+/*
+ * An operation on operands that type inference proved to be integers, or for
+ * equality, to be both integers or both booleans.
+ */
+bool evaluate_infix_typed_operation(Operation operation, Object* object, const Object* object_right)
 {
-    if (!evaluate_expression(environment, expression->operand[0], object)) {
+    switch (operation) {
+    case OPERATION_EQUAL:
+        if (object->type == OBJECT_BOOL) {
+            return object_init_bool(object, object->boolean == object_right->boolean);
+        }
+        return object_init_bool(object, object->integer == object_right->integer);
+    case OPERATION_NOT_EQUAL:
+        if (object->type == OBJECT_BOOL) {
+            return object_init_bool(object, object->boolean != object_right->boolean);
+        }
+        return object_init_bool(object, object->integer != object_right->integer);
+    case OPERATION_GREATER:
+        return object_init_bool(object, object->integer > object_right->integer);
+    case OPERATION_GREATER_EQUAL:
+        return object_init_bool(object, object->integer >= object_right->integer);
+    case OPERATION_LESS:
+        return object_init_bool(object, object->integer < object_right->integer);
+    case OPERATION_LESS_EQUAL:
+        return object_init_bool(object, object->integer <= object_right->integer);
+    case OPERATION_ADD:
+        object->integer += object_right->integer;
+        return true;
+    case OPERATION_SUBTRACT:
+        object->integer -= object_right->integer;
+        return true;
+    case OPERATION_MULTIPLY:
+        object->integer *= object_right->integer;
+        return true;
+    case OPERATION_DIVIDE:
+        object->integer /= object_right->integer;
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool evaluate_infix_expression(Environment* environment, Expression* expression, Object* object)
+{
+    InfixExpression* infix = &expression->infix;
+    if (!evaluate_expression(environment, infix->operand[0], object)) {
         return false;
     }
 
     Object object_right;
-    if (!evaluate_expression(environment, expression->operand[1], &object_right)) {
+    if (!evaluate_expression(environment, infix->operand[1], &object_right)) {
         return false;
+    } else if (infix->typed) {
+        return evaluate_infix_typed_operation(infix->operation, object, &object_right);
+    } else if (evaluate_observe(&infix->observed, object->type == OBJECT_INTEGER && object_right.type == OBJECT_INTEGER)) {
+        expression->type = EXPRESSION_INFIX_INTEGER;
     }
 
-    bool result = evaluate_infix_expression_aux(environment, expression, object, &object_right);
+    bool result = evaluate_infix_operation(infix->operation, object, &object_right);
+    object_free(&object_right);
+    return result;
+}
+
+bool evaluate_infix_integer_expression(Environment* environment, Expression* expression, Object* object)
+{
+    InfixExpression* infix = &expression->infix;
+    if (!evaluate_expression(environment, infix->operand[0], object)) {
+        return false;
+    }
+
+    Object object_right;
+    if (!evaluate_expression(environment, infix->operand[1], &object_right)) {
+        return false;
+    } else if (object->type == OBJECT_INTEGER && object_right.type == OBJECT_INTEGER) {
+        return evaluate_infix_typed_operation(infix->operation, object, &object_right);
+    }
+
+    evaluate_revert(expression, EXPRESSION_INFIX, &infix->observed);
+    bool result = evaluate_infix_operation(infix->operation, object, &object_right);
     object_free(&object_right);
     return result;
 }
@@ -198,8 +327,12 @@ bool evaluate_statement_block_aux(Environment* environment, StatementBlock* bloc
 
 bool evaluate_statement_block(Environment* environment, StatementBlock* block, Object* object)
 {
+    if (block->scope.size == 0) {
+        return evaluate_statement_block_aux(environment, block, object);
+    }
+
     Environment environment_new;
-    environment_init(&environment_new, environment);
+    environment_init(&environment_new, environment, &block->scope);
     bool result = evaluate_statement_block_aux(&environment_new, block, object);
     environment_free(&environment_new);
     return result;
@@ -209,7 +342,7 @@ bool evaluate_conditional_expression(Environment* environment, ConditionalExpres
 {
     if (!evaluate_expression(environment, expression->condition, object)) {
         return false;
-    } else if (object->type != OBJECT_BOOL) {
+    } else if (!expression->typed && object->type != OBJECT_BOOL) {
         printf("*** EVALUATION ERROR: non-bool result in conditional expression\n");
         return false;
     }
@@ -226,39 +359,71 @@ bool evaluate_conditional_expression(Environment* environment, ConditionalExpres
     return true;
 }
 
-bool evaluate_call_expression_arguments(Environment* environment, List* parameter, List* argument)
+bool evaluate_call_expression_arguments(Environment* environment, const FunctionExpression* function, CallExpression* expression)
 {
-    if (parameter == NULL && argument == NULL) {
-        return true;
-    } else if (parameter == NULL) {
+    size_t size = function->parameters_size < expression->arguments_size ? function->parameters_size : expression->arguments_size;
+
+    // note need to use "previous" environment; parameters occupy the first slots
+    for (size_t i = 0; i < size; ++i) {
+        if (!evaluate_expression(environment->next, &expression->arguments[i], &environment->objects[i])) {
+            return false;
+        }
+    }
+
+    if (function->parameters_size < expression->arguments_size) {
         printf("*** EVALUATION ERROR: too many arguments in call expression\n");
         return false;
-    } else if (argument == NULL) {
+    } else if (function->parameters_size > expression->arguments_size) {
         printf("*** EVALUATION ERROR: not enough arguments in call expression\n");
         return false;
     }
+    return true;
+}
 
-    // note need to use "previous" environment
-    Object object;
-    if (!evaluate_expression(environment->next, (Expression*)argument->data, &object)) {
+/*
+ * Parse and resolve the body of a function that is parsed lazily when it is
+ * first called. The global environment gains slots for any names the body
+ * added to the global scope.
+ */
+bool evaluate_function_body(Environment* environment, FunctionExpression* function)
+{
+    Error error;
+    Environment* global = environment->global;
+    if (!parser_parse_function_body(function, &error)) {
+        error_print(&error);
         return false;
-    } else if (!environment_insert(environment, (String*)parameter->data, &object)) {
+    } else if (!resolve_function((Scope*)global->scope, function)) {
         return false;
     }
-    object_free(&object);
-
-    return evaluate_call_expression_arguments(environment, parameter->next, argument->next);
+    environment_extend(global);
+    return true;
 }
 
-bool evaluate_call_expression_external(Environment* environment, CallExpression* expression, Object* object_fn, Object* object)
+bool evaluate_call_expression_external(Environment* environment, CallExpression* expression, FunctionExpression* function, Object* object)
 {
+    if (function->body == NULL && !evaluate_function_body(environment, function)) {
+        return false;
+    }
+
+    // a function without parameters or variables runs in the caller environment
+    StatementBlock* body = function->body;
+    if (body->scope.size == 0) {
+        if (expression->arguments_size > 0) {
+            printf("*** EVALUATION ERROR: too many arguments in call expression\n");
+            return false;
+        } else if (!evaluate_statement_block_aux(environment, body, object)) {
+            return false;
+        }
+        object->returned = false;
+        return true;
+    }
 
     Environment environment_new;
-    environment_init(&environment_new, environment);
-    if (!evaluate_call_expression_arguments(&environment_new, object_fn->function->parameters, expression->arguments)) {
+    environment_init(&environment_new, environment, &body->scope);
+    if (!evaluate_call_expression_arguments(&environment_new, function, expression)) {
         environment_free(&environment_new);
         return false;
-    } else if (!evaluate_statement_block_aux(&environment_new, object_fn->function->body, object)) {
+    } else if (!evaluate_statement_block_aux(&environment_new, body, object)) {
         environment_free(&environment_new);
         return false;
     } else if (object->returned) {
@@ -271,29 +436,40 @@ bool evaluate_call_expression_external(Environment* environment, CallExpression*
 
 bool evaluate_call_expression_internal(Environment* environment, CallExpression* expression, Object* object_fn, Object* object)
 {
-    if (expression->arguments == NULL) {
+    if (expression->arguments_size == 0) {
         printf("*** EVALUATION ERROR: not enough arguments in call expression\n");
         return false;
-    } else if (expression->arguments->next != NULL) {
+    } else if (expression->arguments_size > 1) {
         printf("*** EVALUATION ERROR: too many arguments in call expression\n");
         return false;
-    } else if (!evaluate_expression(environment, (Expression*)expression->arguments->data, object)) {
+    } else if (!evaluate_expression(environment, &expression->arguments[0], object)) {
         return false;
     }
 
     return object_fn->internal(object);
 }
 
-bool evaluate_call_expression(Environment* environment, CallExpression* expression, Object* object)
+/*
+ * A call of a variable that keeps holding the same function is specialized
+ * into a direct call of that function.
+ */
+bool evaluate_call_expression(Environment* environment, Expression* expression, Object* object)
 {
+    CallExpression* call = &expression->call;
     Object object_fn;
     bool result = false;
-    if (!evaluate_expression(environment, expression->function, &object_fn)) {
+    if (!evaluate_expression(environment, call->function, &object_fn)) {
         return false;
     } else if (object_fn.type == OBJECT_FUNCTION) {
-        result = evaluate_call_expression_external(environment, expression, &object_fn, object);
+        ExpressionType type = call->function->type;
+        bool identifier = type == EXPRESSION_IDENTIFIER || type == EXPRESSION_IDENTIFIER_INTEGER;
+        if (evaluate_observe(&call->observed, identifier && call->target == object_fn.function)) {
+            expression->type = EXPRESSION_CALL_DIRECT;
+        }
+        call->target = object_fn.function;
+        result = evaluate_call_expression_external(environment, call, object_fn.function, object);
     } else if (object_fn.type == OBJECT_INTERNAL) {
-        result = evaluate_call_expression_internal(environment, expression, &object_fn, object);
+        result = evaluate_call_expression_internal(environment, call, &object_fn, object);
     } else {
         printf("*** EVALUATION ERROR: non-function object in call expression\n");
     }
@@ -301,27 +477,44 @@ bool evaluate_call_expression(Environment* environment, CallExpression* expressi
     return result;
 }
 
+bool evaluate_call_direct_expression(Environment* environment, Expression* expression, Object* object)
+{
+    CallExpression* call = &expression->call;
+    const Object* value = environment_lookup(environment, &call->function->identifier.binding);
+    if (value == NULL || value->type != OBJECT_FUNCTION || value->function != call->target) {
+        evaluate_revert(expression, EXPRESSION_CALL, &call->observed);
+        return evaluate_call_expression(environment, expression, object);
+    }
+    return evaluate_call_expression_external(environment, call, call->target, object);
+}
+
 bool evaluate_expression(Environment* environment, Expression* expression, Object* object)
 {
     switch (expression->type) {
     case EXPRESSION_IDENTIFIER:
-        return evaluate_identifier_expression(environment, &expression->identifier, object);
+        return evaluate_identifier_expression(environment, expression, object);
+    case EXPRESSION_IDENTIFIER_INTEGER:
+        return evaluate_identifier_integer_expression(environment, expression, object);
     case EXPRESSION_INTEGER:
         return object_init_integer(object, expression->integer.value);
     case EXPRESSION_STRING:
-        return object_init_string(object, &expression->string.value);
+        return object_init_string_constant(object, expression->string.constant);
     case EXPRESSION_BOOL:
         return object_init_bool(object, expression->boolean.value);
     case EXPRESSION_PREFIX:
         return evaluate_prefix_expression(environment, &expression->prefix, object);
     case EXPRESSION_INFIX:
-        return evaluate_infix_expression(environment, &expression->infix, object);
+        return evaluate_infix_expression(environment, expression, object);
+    case EXPRESSION_INFIX_INTEGER:
+        return evaluate_infix_integer_expression(environment, expression, object);
     case EXPRESSION_CONDITIONAL:
         return evaluate_conditional_expression(environment, &expression->conditional, object);
     case EXPRESSION_FUNCTION:
         return object_init_function(object, &expression->function);
     case EXPRESSION_CALL:
-        return evaluate_call_expression(environment, &expression->call, object);
+        return evaluate_call_expression(environment, expression, object);
+    case EXPRESSION_CALL_DIRECT:
+        return evaluate_call_direct_expression(environment, expression, object);
     default:
         printf("*** EVALUATION ERROR: unexpected expression type\n");
         return false;
@@ -332,7 +525,7 @@ bool evaluate_let_statement(Environment* environment, Statement* statement, Obje
 {
     if (!evaluate_expression(environment, &statement->expression, object)) {
         return false;
-    } else if (!environment_insert(environment, statement->identifier, object)) {
+    } else if (!environment_insert(environment, &statement->binding, object)) {
         return false;
     }
     object_free(object);
@@ -363,24 +556,54 @@ bool evaluate_statement(Environment* environment, Statement* statement, Object*
     }
 }
 
-void evaluate_program(StatementBlock* block)
+void evaluate_program_internal(Environment* environment, const char* name, bool (*internal)(Object*))
 {
-    Environment environment;
-    environment_init(&environment, NULL);
+    size_t slot;
+    if (scope_find(environment->scope, symbol_intern(name), &slot)) {
+        object_init_internal(&environment->objects[slot], internal);
+    }
+}
+
+void evaluate_program_init(Environment* environment, const Scope* scope, Stack* stack)
+{
+    environment_init_global(environment, scope, stack);
+    evaluate_program_internal(environment, "puts", function_puts);
+    evaluate_program_internal(environment, "len", function_length);
+}
+
+/*
+ * Evaluate a top level statement of a program that is resolved and evaluated
+ * one statement at a time. The global environment first gains slots for any
+ * names the statement added to the global scope. Evaluation of the program
+ * ends at an error or a return statement.
+ */
+bool evaluate_program_statement(Environment* environment, Statement* statement)
+{
+    environment_extend(environment);
+
+    Object object;
+    object.type = OBJECT_NULL;
+    if (!evaluate_statement(environment, statement, &object)) {
+        return false;
+    }
+    bool returned = object.returned;
+    object_free(&object);
+    return !returned;
+}
 
-    Object* object;
-    object = malloc(sizeof(Object));
-    object_init_internal(object, function_puts);
-    hash_insert(&environment.table, "puts", object);
+void evaluate_program(StatementBlock* block)
+{
+    Stack stack;
+    stack_init(&stack);
 
-    object = malloc(sizeof(Object));
-    object_init_internal(object, function_length);
-    hash_insert(&environment.table, "len", object);
+    Environment environment;
+    evaluate_program_init(&environment, &block->scope, &stack);
 
-    object = malloc(sizeof(Object));
-    if (evaluate_statement_block_aux(&environment, block, object)) {
-        object_free(object);
+    Object object;
+    object.type = OBJECT_NULL;
+    if (evaluate_statement_block_aux(&environment, block, &object)) {
+        object_free(&object);
     }
-    free(object);
     environment_free(&environment);
+    stack_free(&stack);
 }
@@ -3,22 +3,28 @@
 #include <string.h>
 
 #include "monkey/expression.h"
+#include "monkey/object.h"
 #include "monkey/operation.h"
+#include "monkey/statement.h"
 #include "monkey/string.h"
-
-void statement_block_free(const StatementBlock*);
-void statement_block_print(const StatementBlock*, int);
-
-Expression* expression_new()
+#include "monkey/symbol.h"
+
+/*
+ * Expressions are allocated from the arena of the parser and are only released
+ * together with it. Freeing an expression releases the resources it owns
+ * outside the arena, but not the expression itself.
+ */
+Expression* expression_new(Arena* arena)
 {
-    Expression* expression = (Expression*)malloc(sizeof(Expression));
+    Expression* expression = (Expression*)arena_allocate(arena, sizeof(Expression));
     expression->type = EXPRESSION_NONE;
+    expression->shared = false;
     return expression;
 }
 
-Expression* expression_move(const Expression* source)
+Expression* expression_move(Arena* arena, const Expression* source)
 {
-    Expression* expression = (Expression*)malloc(sizeof(Expression));
+    Expression* expression = (Expression*)arena_allocate(arena, sizeof(Expression));
     memcpy(expression, source, sizeof(Expression));
     return expression;
 }
@@ -26,6 +32,7 @@ Expression* expression_move(const Expression* source)
 bool expression_init_integer(Expression* expression, int value)
 {
     expression->type = EXPRESSION_INTEGER;
+    expression->shared = false;
     expression->integer.value = value;
     return true;
 }
@@ -33,149 +40,223 @@ bool expression_init_integer(Expression* expression, int value)
 bool expression_init_bool(Expression* expression, bool value)
 {
     expression->type = EXPRESSION_BOOL;
+    expression->shared = false;
     expression->boolean.value = value;
     return true;
 }
 
-bool expression_init_string(Expression* expression, String* value)
+bool expression_init_string(Expression* expression, ObjectString* constant)
 {
     expression->type = EXPRESSION_STRING;
-    string_copy(&expression->string.value, value);
+    expression->shared = false;
+    expression->string.constant = constant;
     return true;
 }
 
-bool expression_init_identifier(Expression* expression, String* value)
+bool expression_init_identifier(Expression* expression, const Symbol* symbol)
 {
     expression->type = EXPRESSION_IDENTIFIER;
-    string_copy(&expression->identifier.value, value);
+    expression->shared = false;
+    expression->identifier.symbol = symbol;
+    binding_init(&expression->identifier.binding);
+    expression->identifier.observed = 0;
     return true;
 }
 
-bool expression_init_prefix(Expression* expression, Operation operation)
+bool expression_init_prefix(Expression* expression, Arena* arena, Operation operation)
 {
     expression->type = EXPRESSION_PREFIX;
+    expression->shared = false;
     expression->prefix.operation = operation;
-    expression->prefix.operand = expression_new();
+    expression->prefix.operand = expression_new(arena);
+    expression->prefix.typed = false;
     return true;
 }
 
-bool expression_init_infix(Expression* expression, Expression* expression_left, Operation operation)
+bool expression_init_infix(Expression* expression, Arena* arena, Expression* expression_left, Operation operation)
 {
     expression->type = EXPRESSION_INFIX;
+    expression->shared = false;
     expression->infix.operand[0] = expression_left;
-    expression->infix.operand[1] = expression_new();
+    expression->infix.operand[1] = expression_new(arena);
     expression->infix.operation = operation;
+    expression->infix.typed = false;
+    expression->infix.observed = 0;
     return true;
 }
 
-bool expression_init_conditional(Expression* expression)
+bool expression_init_conditional(Expression* expression, Arena* arena)
 {
     expression->type = EXPRESSION_CONDITIONAL;
-    expression->conditional.condition = expression_new();
+    expression->shared = false;
+    expression->conditional.condition = expression_new(arena);
     expression->conditional.consequence = NULL;
     expression->conditional.alternate = NULL;
+    expression->conditional.typed = false;
     return true;
 }
 
 bool expression_init_function(Expression* expression)
 {
     expression->type = EXPRESSION_FUNCTION;
+    expression->shared = false;
     expression->function.parameters = NULL;
+    expression->function.parameters_size = 0;
     expression->function.body = NULL;
+    expression->function.code = 0;
+    expression->function.parser = NULL;
     return true;
 }
 
 bool expression_init_call(Expression* expression, Expression* function)
 {
     expression->type = EXPRESSION_CALL;
+    expression->shared = false;
     expression->call.function = function;
     expression->call.arguments = NULL;
+    expression->call.arguments_size = 0;
+    expression->call.target = NULL;
+    expression->call.observed = 0;
     return true;
 }
 
-void expression_free_prefix(const PrefixExpression* expression)
-{
-    expression_free(expression->operand);
-    free(expression->operand);
-}
-
-void expression_free_infix(const InfixExpression* expression)
+/*
+ * Trees nest as deeply as the source allows, for instance in a long chain of
+ * operators or in machine generated code, so they are released without
+ * recursion, from a stack of the expressions that remain to be released.
+ */
+typedef struct ExpressionStack ExpressionStack;
+struct ExpressionStack {
+    const Expression** expressions;
+    size_t size;
+    size_t capacity;
+};
+
+void expression_stack_push(ExpressionStack* stack, const Expression* expression)
 {
-    expression_free(expression->operand[0]);
-    free(expression->operand[0]);
-    expression_free(expression->operand[1]);
-    free(expression->operand[1]);
-}
-
-void expression_free_conditional(const ConditionalExpression* expression)
-{
-    expression_free(expression->condition);
-    free(expression->condition);
-    if (expression->consequence != NULL) {
-        statement_block_free(expression->consequence);
-        free(expression->consequence);
-    }
-    if (expression->alternate != NULL) {
-        statement_block_free(expression->alternate);
-        free(expression->alternate);
+    if (stack->size == stack->capacity) {
+        stack->capacity = stack->capacity == 0 ? 16 : 2 * stack->capacity;
+        stack->expressions = (const Expression**)realloc(stack->expressions, stack->capacity * sizeof(Expression*));
     }
+    stack->expressions[stack->size++] = expression;
 }
 
-void expression_free_function_parameters(const List* parameter)
+void expression_stack_push_block(ExpressionStack* stack, const StatementBlock* block)
 {
-    string_free((String*)parameter->data);
-    if (parameter->next != NULL) {
-        expression_free_function_parameters(parameter->next);
-        free(parameter->next);
+    scope_free(&block->scope);
+    for (const Statement* statement = block->head; statement != NULL; statement = statement->next) {
+        expression_stack_push(stack, &statement->expression);
     }
 }
 
-void expression_free_function(const FunctionExpression* expression)
+void expression_stack_release(ExpressionStack* stack)
 {
-    if (expression->parameters != NULL) {
-        expression_free_function_parameters(expression->parameters);
-        free(expression->parameters);
-    }
-    if (expression->body != NULL) {
-        statement_block_free(expression->body);
-        free(expression->body);
+    while (stack->size > 0) {
+        const Expression* expression = stack->expressions[--stack->size];
+        if (expression->shared) {
+            continue;
+        }
+        switch (expression->type) {
+        case EXPRESSION_PREFIX:
+            expression_stack_push(stack, expression->prefix.operand);
+            break;
+        case EXPRESSION_INFIX:
+        case EXPRESSION_INFIX_INTEGER:
+            expression_stack_push(stack, expression->infix.operand[0]);
+            expression_stack_push(stack, expression->infix.operand[1]);
+            break;
+        case EXPRESSION_CONDITIONAL:
+            expression_stack_push(stack, expression->conditional.condition);
+            if (expression->conditional.consequence != NULL) {
+                expression_stack_push_block(stack, expression->conditional.consequence);
+            }
+            if (expression->conditional.alternate != NULL) {
+                expression_stack_push_block(stack, expression->conditional.alternate);
+            }
+            break;
+        case EXPRESSION_FUNCTION:
+            if (expression->function.body != NULL) {
+                expression_stack_push_block(stack, expression->function.body);
+            }
+            break;
+        case EXPRESSION_CALL:
+        case EXPRESSION_CALL_DIRECT:
+            expression_stack_push(stack, expression->call.function);
+            for (size_t i = 0; i < expression->call.arguments_size; ++i) {
+                expression_stack_push(stack, &expression->call.arguments[i]);
+            }
+            break;
+        default:
+            break;
+        }
     }
 }
 
-void expression_free_call_arguments(const List* argument)
+void expression_free(const Expression* expression)
 {
-    expression_free((Expression*)argument->data);
-    if (argument->next != NULL) {
-        expression_free_call_arguments(argument->next);
-        free(argument->next);
+    // only expressions with operands or blocks own anything outside the arena
+    switch (expression->type) {
+    case EXPRESSION_PREFIX:
+    case EXPRESSION_INFIX:
+    case EXPRESSION_CONDITIONAL:
+    case EXPRESSION_FUNCTION:
+    case EXPRESSION_CALL:
+    case EXPRESSION_INFIX_INTEGER:
+    case EXPRESSION_CALL_DIRECT:
+        break;
+    default:
+        return;
     }
+    ExpressionStack stack = { NULL, 0, 0 };
+    expression_stack_push(&stack, expression);
+    expression_stack_release(&stack);
+    free(stack.expressions);
 }
 
-void expression_free_call(const CallExpression* expression)
+/*
+ * The statements of a block are released one at a time, so that the stack
+ * only grows with the size of a single statement.
+ */
+void expression_free_block(const StatementBlock* block)
 {
-    expression_free(expression->function);
-    if (expression->arguments != NULL) {
-        expression_free_call_arguments(expression->arguments);
-        free(expression->arguments);
+    ExpressionStack stack = { NULL, 0, 0 };
+    scope_free(&block->scope);
+    for (const Statement* statement = block->head; statement != NULL; statement = statement->next) {
+        expression_stack_push(&stack, &statement->expression);
+        expression_stack_release(&stack);
     }
+    free(stack.expressions);
 }
 
-void expression_free(const Expression* expression)
+/*
+ * Check whether evaluating an expression may create a function object, which
+ * refers to the tree of the expression for as long as the object exists.
+ */
+bool expression_contains_function(const Expression* expression)
 {
-    if (expression->type == EXPRESSION_STRING) {
-        string_free(&expression->string.value);
-    } else if (expression->type == EXPRESSION_IDENTIFIER) {
-        string_free(&expression->identifier.value);
-    } else if (expression->type == EXPRESSION_PREFIX) {
-        expression_free_prefix(&expression->prefix);
-    } else if (expression->type == EXPRESSION_INFIX) {
-        expression_free_infix(&expression->infix);
-    } else if (expression->type == EXPRESSION_CONDITIONAL) {
-        expression_free_conditional(&expression->conditional);
-    } else if (expression->type == EXPRESSION_FUNCTION) {
-        expression_free_function(&expression->function);
-    } else if (expression->type == EXPRESSION_CALL) {
-        expression_free_call(&expression->call);
+    switch (expression->type) {
+    case EXPRESSION_PREFIX:
+        return expression_contains_function(expression->prefix.operand);
+    case EXPRESSION_INFIX:
+    case EXPRESSION_INFIX_INTEGER:
+        return expression_contains_function(expression->infix.operand[0])
+            || expression_contains_function(expression->infix.operand[1]);
+    case EXPRESSION_CONDITIONAL:
+        return expression_contains_function(expression->conditional.condition)
+            || statement_block_contains_function(expression->conditional.consequence)
+            || (expression->conditional.alternate != NULL && statement_block_contains_function(expression->conditional.alternate));
+    case EXPRESSION_FUNCTION:
+        return true;
+    case EXPRESSION_CALL:
+    case EXPRESSION_CALL_DIRECT:
+        for (size_t i = 0; i < expression->call.arguments_size; ++i) {
+            if (expression_contains_function(&expression->call.arguments[i])) {
+                return true;
+            }
+        }
+        return expression_contains_function(expression->call.function);
+    default:
+        return false;
     }
 }
 
@@ -193,14 +274,14 @@ void expression_print_string(StringExpression expression, int indent)
 {
     printf("%*s", indent * 4, "");
     putchar('"');
-    string_print(&expression.value);
+    string_print(&expression.constant->value);
     putchar('"');
 }
 
 void expression_print_identifier(IdentifierExpression expression, int indent)
 {
     printf("%*s", indent * 4, "");
-    string_print(&expression.value);
+    string_print(&expression.symbol->name);
 }
 
 void expression_print_prefix(PrefixExpression expression, int indent, bool group)
@@ -250,14 +331,13 @@ void expression_print_conditional(ConditionalExpression expression, int indent)
     }
 }
 
-void expression_print_function_parameters(List* parameters)
+void expression_print_function_parameters(const FunctionExpression* expression)
 {
-    while (parameters != NULL) {
-        string_print((String*)parameters->data);
-        if (parameters->next != NULL) {
+    for (size_t i = 0; i < expression->parameters_size; ++i) {
+        if (i > 0) {
             printf(", ");
         }
-        parameters = parameters->next;
+        string_print(&expression->parameters[i]->name);
     }
 }
 
@@ -265,21 +345,20 @@ void expression_print_function(FunctionExpression expression, int indent)
 {
     printf("%*s", indent * 4, "");
     printf("fn(");
-    expression_print_function_parameters(expression.parameters);
+    expression_print_function_parameters(&expression);
     printf(") {\n");
     statement_block_print(expression.body, indent + 1);
     printf("%*s", indent * 4, "");
     putchar('}');
 }
 
-void expression_print_call_arguments(List* arguments)
+void expression_print_call_arguments(const CallExpression* expression)
 {
-    while (arguments != NULL) {
-        expression_print((Expression*)arguments->data, 0, false);
-        if (arguments->next != NULL) {
+    for (size_t i = 0; i < expression->arguments_size; ++i) {
+        if (i > 0) {
             printf(", ");
         }
-        arguments = arguments->next;
+        expression_print(&expression->arguments[i], 0, false);
     }
 }
 
@@ -288,7 +367,7 @@ void expression_print_call(CallExpression expression, int indent)
     printf("%*s", indent * 4, "");
     expression_print(expression.function, 0, false);
     putchar('(');
-    expression_print_call_arguments(expression.arguments);
+    expression_print_call_arguments(&expression);
     putchar(')');
 }
 
@@ -307,12 +386,14 @@ void expression_print(const Expression* expression, int indent, bool group)
         expression_print_string(expression->string, indent);
         break;
     case EXPRESSION_IDENTIFIER:
+    case EXPRESSION_IDENTIFIER_INTEGER:
         expression_print_identifier(expression->identifier, indent);
         break;
     case EXPRESSION_PREFIX:
         expression_print_prefix(expression->prefix, indent, group);
         break;
     case EXPRESSION_INFIX:
+    case EXPRESSION_INFIX_INTEGER:
         expression_print_infix(expression->infix, indent, group);
         break;
     case EXPRESSION_CONDITIONAL:
@@ -322,7 +403,46 @@ void expression_print(const Expression* expression, int indent, bool group)
         expression_print_function(expression->function, indent);
         break;
     case EXPRESSION_CALL:
+    case EXPRESSION_CALL_DIRECT:
         expression_print_call(expression->call, indent);
         break;
     }
 }
+
+void expression_spine_init(ExpressionSpine* spine)
+{
+    spine->expressions = NULL;
+    spine->size = 0;
+    spine->capacity = 0;
+}
+
+void expression_spine_free(const ExpressionSpine* spine)
+{
+    free(spine->expressions);
+}
+
+/*
+ * Push the operations of a chain, outermost first, and return the leftmost
+ * operand of the chain.
+ */
+Expression* expression_spine_push(ExpressionSpine* spine, Expression* expression)
+{
+    while (expression->type == EXPRESSION_INFIX) {
+        if (spine->size >= spine->capacity) {
+            spine->capacity = spine->capacity == 0 ? 16 : 2 * spine->capacity;
+            spine->expressions = (Expression**)realloc(spine->expressions, spine->capacity * sizeof(Expression*));
+        }
+        spine->expressions[spine->size++] = expression;
+        expression = expression->infix.operand[0];
+    }
+    return expression;
+}
+
+/*
+ * Pop the innermost operation left above the given size, or return NULL once
+ * the spine is back down to it.
+ */
+Expression* expression_spine_pop(ExpressionSpine* spine, size_t base)
+{
+    return spine->size > base ? spine->expressions[--spine->size] : NULL;
+}
@@ -10,7 +10,7 @@ bool function_length(Object* object)
         printf("*** EVALUATION ERROR: expected string argument in len function\n");
         return false;
     }
-    int length = string_length(object->string);
+    int length = (int)object_string_length(object);
     object_free(object);
     object_init_integer(object, length);
     return true;
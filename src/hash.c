@@ -1,76 +1,164 @@
-#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "monkey/hash.h"
 
+#define HASH_CAPACITY_MIN 8
+
 void hash_init(HashTable* table)
 {
-    for (size_t i = 0; i < 256; ++i) {
-        table->buckets[i] = NULL;
-    }
+    table->entries = NULL;
+    table->size = 0;
+    table->capacity = 0;
 }
 
-void hash_bucket_free(HashBucket* bucket, void (*value_free)(void*))
+void hash_free(const HashTable* table, void (*value_free)(void*))
 {
-    if (bucket != NULL) {
-        hash_bucket_free(bucket->next, value_free);
-        value_free(bucket->value);
-        free(bucket);
+    for (size_t i = 0; i < table->capacity; ++i) {
+        if (table->entries[i].key != NULL) {
+            value_free(table->entries[i].value);
+        }
     }
+    free(table->entries);
 }
 
-void hash_free(const HashTable* table, void (*ff)(void*))
+/*
+ * This function implements the FNV-1a hash algorithm, 64 bit size. The full
+ * hash is stored with each entry so that most mismatches during a probe are
+ * rejected without comparing the keys.
+ */
+uint64_t hash_key(const char* key)
 {
-    for (size_t i = 0; i < 256; ++i) {
-        hash_bucket_free(table->buckets[i], ff);
+    return hash_key_span(key, strlen(key));
+}
+
+uint64_t hash_key_span(const char* key, size_t length)
+{
+    uint64_t hash = 14695981039346656037u;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (uint64_t)(unsigned char)key[i];
+        hash *= 1099511628211u;
     }
+    return hash;
+}
+
+size_t hash_distance(const HashTable* table, const HashEntry* entry, size_t index)
+{
+    return (index - (size_t)entry->hash) & (table->capacity - 1);
 }
 
 /*
- * This function implements the FNV-1a hash algorithm, 64 bit size. The
- * implementation applies xor-folding to the result to reduce its size to eight
- * bits. This is more appropriate for the small expected hash sizes in this
- * context.
+ * Place an entry using Robin Hood hashing: an entry that is further from its
+ * home slot than the one occupying a slot takes that slot, and the displaced
+ * entry continues probing. This keeps probe sequences short and uniform even
+ * at high load.
  */
-unsigned char hash_index(const char* key)
+void hash_place(HashTable* table, HashEntry entry)
 {
-    unsigned long hash = 14695981039346656037u;
-    while (*key) {
-        hash ^= (unsigned long)*key++;
-        hash *= 1099511628211u;
+    size_t mask = table->capacity - 1;
+    size_t index = (size_t)entry.hash & mask;
+    for (size_t distance = 0;; ++distance, index = (index + 1) & mask) {
+        HashEntry* slot = &table->entries[index];
+        if (slot->key == NULL) {
+            *slot = entry;
+            table->size++;
+            return;
+        }
+        size_t slot_distance = hash_distance(table, slot, index);
+        if (slot_distance < distance) {
+            HashEntry displaced = *slot;
+            *slot = entry;
+            entry = displaced;
+            distance = slot_distance;
+        }
     }
+}
 
-    // xor-fold
-    unsigned char* index = (unsigned char*)&hash;
-    for (size_t i = 1; i < sizeof(unsigned long); ++i) {
-        index[0] ^= index[i];
+void hash_resize(HashTable* table, size_t capacity)
+{
+    HashEntry* entries = table->entries;
+    size_t size = table->capacity;
+
+    table->entries = (HashEntry*)calloc(capacity, sizeof(HashEntry));
+    table->capacity = capacity;
+    table->size = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (entries[i].key != NULL) {
+            hash_place(table, entries[i]);
+        }
     }
+    free(entries);
+}
 
-    return index[0];
+/*
+ * Find the entry of a key given by its characters and length, which need not
+ * be null terminated. Keys stored in the table always are.
+ */
+HashEntry* hash_find(const HashTable* table, const char* key, size_t length, uint64_t hash)
+{
+    if (table->size == 0) {
+        return NULL;
+    }
+
+    size_t mask = table->capacity - 1;
+    size_t index = (size_t)hash & mask;
+    for (size_t distance = 0;; ++distance, index = (index + 1) & mask) {
+        HashEntry* entry = &table->entries[index];
+        // an entry closer to its home slot than the probe ends the search
+        if (entry->key == NULL || hash_distance(table, entry, index) < distance) {
+            return NULL;
+        } else if (entry->hash != hash) {
+            continue;
+        } else if (entry->key == key || (strncmp(entry->key, key, length) == 0 && entry->key[length] == '\0')) {
+            return entry;
+        }
+    }
 }
 
-void hash_insert(HashTable* table, char* key, void* value)
+/*
+ * Insert a value under the given key and return the value it replaces, if
+ * any. The table starts out empty and grows by doubling whenever it becomes
+ * three quarters full.
+ */
+void* hash_insert(HashTable* table, char* key, void* value)
 {
-    unsigned char index = hash_index(key);
+    return hash_insert_hash(table, key, hash_key(key), value);
+}
 
-    HashBucket* bucket = (HashBucket*)malloc(sizeof(HashBucket));
-    bucket->key = key;
-    bucket->value = value;
-    bucket->next = table->buckets[index];
+/*
+ * Insert a value under a key whose hash has already been computed, such as
+ * the name of an interned symbol.
+ */
+void* hash_insert_hash(HashTable* table, char* key, uint64_t hash, void* value)
+{
+    HashEntry* entry = hash_find(table, key, strlen(key), hash);
+    if (entry != NULL) {
+        void* previous = entry->value;
+        entry->value = value;
+        return previous;
+    }
 
-    table->buckets[index] = bucket;
+    if (4 * (table->size + 1) > 3 * table->capacity) {
+        hash_resize(table, table->capacity == 0 ? HASH_CAPACITY_MIN : 2 * table->capacity);
+    }
+    hash_place(table, (HashEntry) { key, value, hash });
+    return NULL;
 }
 
 void* hash_retrieve(const HashTable* table, const char* key)
 {
-    unsigned char index = hash_index(key);
+    return hash_retrieve_hash(table, key, hash_key(key));
+}
 
-    for (HashBucket* bucket = table->buckets[index]; bucket != NULL; bucket = bucket->next) {
-        if (strcmp(key, bucket->key) == 0) {
-            return bucket->value;
-        }
-    }
+void* hash_retrieve_hash(const HashTable* table, const char* key, uint64_t hash)
+{
+    return hash_retrieve_span(table, key, strlen(key), hash);
+}
 
-    return NULL;
+void* hash_retrieve_span(const HashTable* table, const char* key, size_t length, uint64_t hash)
+{
+    HashEntry* entry = hash_find(table, key, length, hash);
+    return entry == NULL ? NULL : entry->value;
 }
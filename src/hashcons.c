@@ -0,0 +1,162 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "monkey/expression.h"
+#include "monkey/hash.h"
+#include "monkey/hashcons.h"
+#include "monkey/statement.h"
+
+void hashcons_init(HashCons* hashcons)
+{
+    arena_init(&hashcons->arena);
+    hash_init(&hashcons->table);
+    expression_spine_init(&hashcons->spine);
+}
+
+void hashcons_free_value(void* value)
+{
+    (void)value;
+}
+
+/*
+ * The canonical subtrees must outlive every tree they were shared with.
+ */
+void hashcons_free(HashCons* hashcons)
+{
+    hash_free(&hashcons->table, hashcons_free_value);
+    arena_free(&hashcons->arena);
+    expression_spine_free(&hashcons->spine);
+}
+
+/*
+ * Find the canonical copy of an immutable expression whose operands are
+ * already canonical, so that the key of an operator only needs the addresses
+ * of its operands. String literals are interned as constants, so they are
+ * keyed by their constant.
+ */
+Expression* hashcons_canonical(HashCons* hashcons, Expression* expression)
+{
+    char buffer[64];
+    int length;
+    switch (expression->type) {
+    case EXPRESSION_INTEGER:
+        length = snprintf(buffer, sizeof(buffer), "i%d", expression->integer.value);
+        break;
+    case EXPRESSION_BOOL:
+        length = snprintf(buffer, sizeof(buffer), "b%d", expression->boolean.value);
+        break;
+    case EXPRESSION_PREFIX:
+        length = snprintf(buffer, sizeof(buffer), "p%d:%p", expression->prefix.operation, (void*)expression->prefix.operand);
+        break;
+    case EXPRESSION_INFIX:
+        length = snprintf(buffer, sizeof(buffer), "n%d:%p:%p", expression->infix.operation, (void*)expression->infix.operand[0], (void*)expression->infix.operand[1]);
+        break;
+    default:
+        length = snprintf(buffer, sizeof(buffer), "s%p", (void*)expression->string.constant);
+        break;
+    }
+
+    uint64_t hash = hash_key_span(buffer, (size_t)length);
+    Expression* canonical = (Expression*)hash_retrieve_span(&hashcons->table, buffer, (size_t)length, hash);
+    if (canonical != NULL) {
+        return canonical;
+    }
+
+    char* key = (char*)arena_allocate(&hashcons->arena, (size_t)length + 1);
+    memcpy(key, buffer, (size_t)length + 1);
+    canonical = (Expression*)arena_allocate(&hashcons->arena, sizeof(Expression));
+    *canonical = *expression;
+    canonical->shared = true;
+    hash_insert_hash(&hashcons->table, key, hash, canonical);
+    return canonical;
+}
+
+void hashcons_block(HashCons*, StatementBlock*);
+bool hashcons_place(HashCons*, Expression**);
+
+/*
+ * Share the operands of an expression, and tell whether the expression itself
+ * is immutable and may then be shared.
+ */
+bool hashcons_operands(HashCons* hashcons, Expression* expression)
+{
+    switch (expression->type) {
+    case EXPRESSION_INTEGER:
+    case EXPRESSION_BOOL:
+    case EXPRESSION_STRING:
+        return true;
+    case EXPRESSION_PREFIX:
+        return hashcons_place(hashcons, &expression->prefix.operand);
+    case EXPRESSION_INFIX:
+        break;
+    case EXPRESSION_CONDITIONAL:
+        hashcons_place(hashcons, &expression->conditional.condition);
+        hashcons_block(hashcons, expression->conditional.consequence);
+        if (expression->conditional.alternate != NULL) {
+            hashcons_block(hashcons, expression->conditional.alternate);
+        }
+        return false;
+    case EXPRESSION_FUNCTION:
+        if (expression->function.body != NULL) {
+            hashcons_block(hashcons, expression->function.body);
+        }
+        return false;
+    case EXPRESSION_CALL:
+        hashcons_place(hashcons, &expression->call.function);
+        for (size_t i = 0; i < expression->call.arguments_size; ++i) {
+            Expression* argument = &expression->call.arguments[i];
+            if (hashcons_operands(hashcons, argument)) {
+                *argument = *hashcons_canonical(hashcons, argument);
+            }
+        }
+        return false;
+    default:
+        return false;
+    }
+
+    // a left operand is replaced by its canonical copy once its own right operand is shared
+    size_t base = hashcons->spine.size;
+    expression_spine_push(&hashcons->spine, expression);
+    bool shared = hashcons_place(hashcons, &hashcons->spine.expressions[hashcons->spine.size - 1]->infix.operand[0]);
+    Expression* infix;
+    while ((infix = expression_spine_pop(&hashcons->spine, base)) != NULL) {
+        shared = hashcons_place(hashcons, &infix->infix.operand[1]) && shared;
+        if (shared && hashcons->spine.size > base) {
+            hashcons->spine.expressions[hashcons->spine.size - 1]->infix.operand[0] = hashcons_canonical(hashcons, infix);
+        }
+    }
+    return shared;
+}
+
+/*
+ * Share an expression referred to by a pointer, which is redirected to the
+ * canonical copy. Returns whether the expression is now shared.
+ */
+bool hashcons_place(HashCons* hashcons, Expression** place)
+{
+    if (!hashcons_operands(hashcons, *place)) {
+        return false;
+    }
+    *place = hashcons_canonical(hashcons, *place);
+    return true;
+}
+
+/*
+ * Expressions held in place, such as those of statements and the arguments of
+ * calls, are replaced by a copy of the canonical expression instead.
+ */
+void hashcons_block(HashCons* hashcons, StatementBlock* block)
+{
+    for (Statement* statement = block->head; statement != NULL; statement = statement->next) {
+        if (hashcons_operands(hashcons, &statement->expression)) {
+            statement->expression = *hashcons_canonical(hashcons, &statement->expression);
+        }
+    }
+}
+
+void hashcons_program(HashCons* hashcons, StatementBlock* block)
+{
+    hashcons_block(hashcons, block);
+}
@@ -0,0 +1,490 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "monkey/expression.h"
+#include "monkey/hash.h"
+#include "monkey/infer.h"
+#include "monkey/operation.h"
+#include "monkey/scope.h"
+#include "monkey/statement.h"
+#include "monkey/symbol.h"
+
+/*
+ * Type inference runs over a resolved program and marks the operations whose
+ * operands are proved to have the types they expect, so that they are
+ * evaluated without checks. Literals have known types, and a variable has the
+ * type of the value it was last bound to or found to hold. Variables are
+ * dynamically scoped, but only a let statement in the scope of a variable
+ * changes its value, so what is learned holds until its name is bound again.
+ */
+
+void infer_fact_key(const Inferrer* inferrer, const Binding* binding, InferFact* fact)
+{
+    fact->binding = binding->type;
+    fact->level = binding->type == BINDING_LOCAL ? inferrer->level - binding->depth : 0;
+    fact->slot = binding->slot;
+}
+
+void infer_slots_reserve(InferSlots* slots, size_t size)
+{
+    if (size <= slots->capacity) {
+        return;
+    }
+    size_t capacity = slots->capacity == 0 ? 16 : slots->capacity;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+    slots->facts = (size_t*)realloc(slots->facts, capacity * sizeof(size_t));
+    memset(slots->facts + slots->capacity, 0, (capacity - slots->capacity) * sizeof(size_t));
+    slots->capacity = capacity;
+}
+
+/*
+ * Find the entry holding the latest fact about the variable with the given
+ * key, growing the slots of its scope as needed.
+ */
+size_t* infer_slot(Inferrer* inferrer, const InferFact* key)
+{
+    InferSlots* slots = &inferrer->globals;
+    if (key->binding == BINDING_DYNAMIC) {
+        slots = &inferrer->dynamics;
+    } else if (key->binding == BINDING_LOCAL) {
+        if (key->level >= inferrer->levels_capacity) {
+            size_t capacity = inferrer->levels_capacity == 0 ? 8 : inferrer->levels_capacity;
+            while (capacity <= key->level) {
+                capacity *= 2;
+            }
+            inferrer->levels = (InferSlots*)realloc(inferrer->levels, capacity * sizeof(InferSlots));
+            memset(inferrer->levels + inferrer->levels_capacity, 0, (capacity - inferrer->levels_capacity) * sizeof(InferSlots));
+            inferrer->levels_capacity = capacity;
+        }
+        slots = &inferrer->levels[key->level];
+    }
+    infer_slots_reserve(slots, key->slot + 1);
+    return &slots->facts[key->slot];
+}
+
+size_t infer_name_latest(const Inferrer* inferrer, const Symbol* name)
+{
+    return (uintptr_t)hash_retrieve_hash(&inferrer->names, string_value(&name->name), name->hash);
+}
+
+void infer_name_update(Inferrer* inferrer, const Symbol* name, size_t latest)
+{
+    hash_insert_hash(&inferrer->names, string_value(&name->name), name->hash, (void*)latest);
+}
+
+InferType infer_retrieve(Inferrer* inferrer, const Binding* binding)
+{
+    if (binding->type == BINDING_NONE) {
+        return INFER_UNKNOWN;
+    }
+    InferFact key;
+    infer_fact_key(inferrer, binding, &key);
+    size_t latest = *infer_slot(inferrer, &key);
+    if (latest <= inferrer->base || inferrer->facts[latest - 1].name == NULL) {
+        return INFER_UNKNOWN;
+    }
+    return inferrer->facts[latest - 1].type;
+}
+
+void infer_insert(Inferrer* inferrer, const Symbol* name, const Binding* binding, InferType type)
+{
+    if (type == INFER_UNKNOWN || binding->type == BINDING_NONE) {
+        return;
+    }
+    if (inferrer->facts_size >= inferrer->facts_capacity) {
+        inferrer->facts_capacity = inferrer->facts_capacity == 0 ? 16 : 2 * inferrer->facts_capacity;
+        inferrer->facts = (InferFact*)realloc(inferrer->facts, inferrer->facts_capacity * sizeof(InferFact));
+    }
+    InferFact* fact = &inferrer->facts[inferrer->facts_size++];
+    infer_fact_key(inferrer, binding, fact);
+    fact->name = name;
+    fact->type = type;
+
+    size_t* latest = infer_slot(inferrer, fact);
+    fact->shadowed = *latest;
+    *latest = inferrer->facts_size;
+    fact->previous = infer_name_latest(inferrer, name);
+    infer_name_update(inferrer, name, inferrer->facts_size);
+}
+
+/*
+ * Forget every fact about variables of the given name, whichever scope they
+ * belong to, since a dynamic binding may refer to any of them. Forgotten facts
+ * leave the chain of their name, so each is only visited once.
+ */
+void infer_forget(Inferrer* inferrer, const Symbol* name)
+{
+    size_t latest = infer_name_latest(inferrer, name);
+    if (latest <= inferrer->base) {
+        return;
+    }
+    while (latest > inferrer->base) {
+        InferFact* fact = &inferrer->facts[latest - 1];
+        fact->name = NULL;
+        latest = fact->previous;
+    }
+    infer_name_update(inferrer, name, latest);
+}
+
+/*
+ * Drop the facts learned since the given size, and restore the ones they
+ * shadowed.
+ */
+void infer_restore(Inferrer* inferrer, size_t size)
+{
+    while (inferrer->facts_size > size) {
+        const InferFact* fact = &inferrer->facts[--inferrer->facts_size];
+        *infer_slot(inferrer, fact) = fact->shadowed;
+        if (fact->name != NULL) {
+            infer_name_update(inferrer, fact->name, fact->previous);
+        }
+    }
+}
+
+/*
+ * Learn the type of a variable used as the operand of an operation that only
+ * succeeds on values of that type.
+ */
+void infer_learn(Inferrer* inferrer, const Expression* operand, InferType type)
+{
+    if (operand->type == EXPRESSION_IDENTIFIER && infer_retrieve(inferrer, &operand->identifier.binding) == INFER_UNKNOWN) {
+        infer_insert(inferrer, operand->identifier.symbol, &operand->identifier.binding, type);
+    }
+}
+
+/*
+ * Report an operation that is certain to fail, when it is also certain to be
+ * evaluated and nothing before it may fail. Otherwise it is left to fail at
+ * runtime, since it may never run.
+ */
+bool infer_fail(Inferrer* inferrer, const char* message, Operation operation)
+{
+    if (!inferrer->certain || !inferrer->proven) {
+        inferrer->proven = false;
+        return true;
+    }
+    printf("*** TYPE ERROR: %s", message);
+    if (operation != OPERATION_NONE) {
+        operation_print(operation);
+    }
+    putchar('\n');
+    return false;
+}
+
+bool infer_prefix_expression(Inferrer* inferrer, PrefixExpression* expression, InferType* type)
+{
+    InferType operand;
+    if (!infer_expression(inferrer, expression->operand, &operand)) {
+        return false;
+    }
+
+    InferType expected = expression->operation == OPERATION_NEGATIVE ? INFER_INTEGER : INFER_BOOL;
+    *type = expected;
+    expression->typed = operand == expected;
+    if (operand == INFER_UNKNOWN) {
+        infer_learn(inferrer, expression->operand, expected);
+    } else if (operand != expected && expected == INFER_INTEGER) {
+        return infer_fail(inferrer, "unary - operation applied to non-integer value", OPERATION_NONE);
+    } else if (operand != expected) {
+        return infer_fail(inferrer, "unary ! operation applied to non-bool value", OPERATION_NONE);
+    }
+    inferrer->proven = inferrer->proven && expression->typed;
+    return true;
+}
+
+bool infer_infix_inequality_operation(Inferrer* inferrer, InfixExpression* expression, InferType left, InferType right)
+{
+    if (left != INFER_UNKNOWN && left != INFER_INTEGER) {
+        return infer_fail(inferrer, "expected integer type for infix operation: ", expression->operation);
+    } else if (left == INFER_INTEGER && right != INFER_UNKNOWN && right != INFER_INTEGER) {
+        return infer_fail(inferrer, "mismatched types for infix operation: ", expression->operation);
+    }
+
+    expression->typed = left == INFER_INTEGER && right == INFER_INTEGER;
+    inferrer->proven = inferrer->proven && expression->typed;
+    infer_learn(inferrer, expression->operand[0], INFER_INTEGER);
+    infer_learn(inferrer, expression->operand[1], INFER_INTEGER);
+    return true;
+}
+
+/*
+ * Strings may only be added, so any other arithmetic operation that succeeds
+ * has integer operands, as has an addition with one integer operand.
+ */
+bool infer_infix_arithmetic_operation(Inferrer* inferrer, InfixExpression* expression, InferType left, InferType right, InferType* type)
+{
+    Operation operation = expression->operation;
+    if (left == INFER_STRING && operation != OPERATION_ADD) {
+        return infer_fail(inferrer, "invalid infix operation for string: ", operation);
+    } else if (left == INFER_STRING && right != INFER_UNKNOWN && right != INFER_STRING) {
+        return infer_fail(inferrer, "mismatched types for infix string operation: ", operation);
+    } else if (left != INFER_UNKNOWN && left != INFER_INTEGER && left != INFER_STRING) {
+        return infer_fail(inferrer, "expected integer type for infix operation: ", operation);
+    } else if (left == INFER_INTEGER && right != INFER_UNKNOWN && right != INFER_INTEGER) {
+        return infer_fail(inferrer, "mismatched types for infix operation: ", operation);
+    }
+
+    if (operation != OPERATION_ADD || left == INFER_INTEGER || right == INFER_INTEGER) {
+        *type = INFER_INTEGER;
+    } else if (left == INFER_STRING || right == INFER_STRING) {
+        *type = INFER_STRING;
+    } else {
+        inferrer->proven = false;
+        return true;
+    }
+    expression->typed = *type == INFER_INTEGER && left == INFER_INTEGER && right == INFER_INTEGER;
+    // a division may still fail on a zero divisor
+    inferrer->proven = inferrer->proven && left == *type && right == *type && operation != OPERATION_DIVIDE;
+    infer_learn(inferrer, expression->operand[0], *type);
+    infer_learn(inferrer, expression->operand[1], *type);
+    return true;
+}
+
+bool infer_infix_operation(Inferrer* inferrer, InfixExpression* expression, InferType left, InferType right, InferType* type)
+{
+    expression->typed = false;
+    *type = INFER_UNKNOWN;
+    switch (expression->operation) {
+    case OPERATION_EQUAL:
+    case OPERATION_NOT_EQUAL:
+        // equality applies to values of any types
+        *type = INFER_BOOL;
+        expression->typed = left == right && (left == INFER_INTEGER || left == INFER_BOOL);
+        return true;
+    case OPERATION_GREATER:
+    case OPERATION_GREATER_EQUAL:
+    case OPERATION_LESS:
+    case OPERATION_LESS_EQUAL:
+        *type = INFER_BOOL;
+        return infer_infix_inequality_operation(inferrer, expression, left, right);
+    case OPERATION_ADD:
+    case OPERATION_SUBTRACT:
+    case OPERATION_MULTIPLY:
+    case OPERATION_DIVIDE:
+        return infer_infix_arithmetic_operation(inferrer, expression, left, right, type);
+    default:
+        inferrer->proven = false;
+        return true;
+    }
+}
+
+/*
+ * The operations of a chain are inferred in the order they are evaluated.
+ */
+bool infer_infix_expression(Inferrer* inferrer, Expression* expression, InferType* type)
+{
+    size_t base = inferrer->spine.size;
+    bool result = infer_expression(inferrer, expression_spine_push(&inferrer->spine, expression), type);
+    Expression* infix;
+    while ((infix = expression_spine_pop(&inferrer->spine, base)) != NULL) {
+        InferType right;
+        result = result && infer_expression(inferrer, infix->infix.operand[1], &right)
+            && infer_infix_operation(inferrer, &infix->infix, *type, right, type);
+    }
+    return result;
+}
+
+/*
+ * What is learned within a branch only holds there, and neither branch is
+ * certain to be evaluated, but what follows is only proven when neither branch
+ * may fail.
+ */
+bool infer_conditional_expression(Inferrer* inferrer, ConditionalExpression* expression)
+{
+    InferType condition;
+    if (!infer_expression(inferrer, expression->condition, &condition)) {
+        return false;
+    }
+    expression->typed = condition == INFER_BOOL;
+    if (condition == INFER_UNKNOWN) {
+        infer_learn(inferrer, expression->condition, INFER_BOOL);
+    } else if (condition != INFER_BOOL && !infer_fail(inferrer, "non-bool result in conditional expression", OPERATION_NONE)) {
+        return false;
+    }
+    inferrer->proven = inferrer->proven && expression->typed;
+
+    bool certain = inferrer->certain;
+    inferrer->certain = false;
+    bool result = infer_block(inferrer, expression->consequence);
+    if (result && expression->alternate != NULL) {
+        result = infer_block(inferrer, expression->alternate);
+    }
+    inferrer->certain = certain;
+    return result;
+}
+
+/*
+ * The body of a function is inferred without any facts, since it may be
+ * called from anywhere, and none of its facts hold outside of it.
+ */
+bool infer_function_expression(Inferrer* inferrer, FunctionExpression* expression)
+{
+    if (expression->body == NULL) {
+        // a body that is parsed lazily is evaluated with checks
+        return true;
+    }
+
+    size_t base = inferrer->base;
+    size_t level = inferrer->level;
+    bool certain = inferrer->certain;
+    bool proven = inferrer->proven;
+    bool returns = inferrer->returns;
+    inferrer->base = inferrer->facts_size;
+    inferrer->level = 0;
+    inferrer->certain = false;
+
+    bool result = infer_block(inferrer, expression->body);
+
+    inferrer->base = base;
+    inferrer->level = level;
+    inferrer->certain = certain;
+    inferrer->proven = proven;
+    inferrer->returns = returns;
+    return result;
+}
+
+bool infer_call_expression(Inferrer* inferrer, CallExpression* expression)
+{
+    InferType function;
+    if (!infer_expression(inferrer, expression->function, &function)) {
+        return false;
+    } else if (function != INFER_UNKNOWN && function != INFER_FUNCTION && !infer_fail(inferrer, "non-function object in call expression", OPERATION_NONE)) {
+        return false;
+    }
+
+    // a call cannot bind the variables of its caller, but it may fail
+    inferrer->proven = false;
+    InferType argument;
+    for (size_t i = 0; i < expression->arguments_size; ++i) {
+        if (!infer_expression(inferrer, &expression->arguments[i], &argument)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool infer_expression(Inferrer* inferrer, Expression* expression, InferType* type)
+{
+    *type = INFER_UNKNOWN;
+    switch (expression->type) {
+    case EXPRESSION_INTEGER:
+        *type = INFER_INTEGER;
+        return true;
+    case EXPRESSION_BOOL:
+        *type = INFER_BOOL;
+        return true;
+    case EXPRESSION_STRING:
+        *type = INFER_STRING;
+        return true;
+    case EXPRESSION_IDENTIFIER:
+        // a variable with a known type is certainly bound
+        *type = infer_retrieve(inferrer, &expression->identifier.binding);
+        inferrer->proven = inferrer->proven && *type != INFER_UNKNOWN;
+        return true;
+    case EXPRESSION_PREFIX:
+        return infer_prefix_expression(inferrer, &expression->prefix, type);
+    case EXPRESSION_INFIX:
+        return infer_infix_expression(inferrer, expression, type);
+    case EXPRESSION_CONDITIONAL:
+        return infer_conditional_expression(inferrer, &expression->conditional);
+    case EXPRESSION_FUNCTION:
+        *type = INFER_FUNCTION;
+        return infer_function_expression(inferrer, &expression->function);
+    case EXPRESSION_CALL:
+        return infer_call_expression(inferrer, &expression->call);
+    default:
+        return true;
+    }
+}
+
+/*
+ * A let statement binds a variable in the scope of the block it appears in,
+ * which replaces any earlier value of the same name there.
+ */
+bool infer_statement(Inferrer* inferrer, Statement* statement)
+{
+    InferType type;
+    if (!infer_expression(inferrer, &statement->expression, &type)) {
+        return false;
+    } else if (statement->type == STATEMENT_LET) {
+        infer_forget(inferrer, statement->identifier);
+        infer_insert(inferrer, statement->identifier, &statement->binding, type);
+    } else if (statement->type == STATEMENT_RETURN) {
+        inferrer->returns = true;
+    }
+    return true;
+}
+
+/*
+ * Blocks that declare variables have a scope of their own, one level deeper
+ * than the enclosing block.
+ */
+bool infer_block(Inferrer* inferrer, StatementBlock* block)
+{
+    size_t size = inferrer->facts_size;
+    size_t level = inferrer->level;
+    if (block->scope.size > 0) {
+        inferrer->level++;
+    }
+
+    bool result = true;
+    for (Statement* statement = block->head; statement != NULL && result; statement = statement->next) {
+        result = infer_statement(inferrer, statement);
+    }
+
+    inferrer->level = level;
+    infer_restore(inferrer, size);
+    return result;
+}
+
+void infer_name_free(void* value)
+{
+    (void)value;
+}
+
+/*
+ * Infer the types of a resolved program and report the first type error that
+ * is certain to happen when it runs. Top level statements are certain to be
+ * evaluated up to the first one that may return from the program, and an
+ * error is only reported while none of the expressions before it may fail.
+ */
+bool infer_program(StatementBlock* block)
+{
+    Inferrer inferrer;
+    inferrer.facts = NULL;
+    inferrer.facts_size = 0;
+    inferrer.facts_capacity = 0;
+    inferrer.base = 0;
+    inferrer.level = 0;
+    inferrer.globals = (InferSlots) { NULL, 0 };
+    inferrer.dynamics = (InferSlots) { NULL, 0 };
+    inferrer.levels = NULL;
+    inferrer.levels_capacity = 0;
+    hash_init(&inferrer.names);
+    expression_spine_init(&inferrer.spine);
+    inferrer.certain = true;
+    inferrer.proven = true;
+    inferrer.returns = false;
+
+    bool result = true;
+    for (Statement* statement = block->head; statement != NULL && result; statement = statement->next) {
+        result = infer_statement(&inferrer, statement);
+        inferrer.certain = inferrer.certain && !inferrer.returns;
+    }
+
+    free(inferrer.facts);
+    free(inferrer.globals.facts);
+    free(inferrer.dynamics.facts);
+    for (size_t i = 0; i < inferrer.levels_capacity; ++i) {
+        free(inferrer.levels[i].facts);
+    }
+    free(inferrer.levels);
+    hash_free(&inferrer.names, infer_name_free);
+    expression_spine_free(&inferrer.spine);
+    return result;
+}
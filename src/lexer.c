@@ -1,274 +1,515 @@
-#include <ctype.h>
+#include <errno.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "monkey/lexer.h"
 #include "monkey/token.h"
 
+/*
+ * Character classes used while scanning runs of characters. Every character
+ * other than the quote belongs to the body of a string.
+ */
+#define LEXER_SPACE 0x01
+#define LEXER_ALPHA 0x02
+#define LEXER_DIGIT 0x04
+#define LEXER_IDENTIFIER 0x08
+#define LEXER_STRING 0x10
+
+#define LEXER_BUFFER_SIZE 65536
+
+static uint8_t lexer_classes[256];
+
+/*
+ * The type of the token started by each character, and the type of the token
+ * formed when an operator character is followed by an equals sign.
+ */
+static TokenType lexer_tokens[256];
+static TokenType lexer_tokens_equal[256];
+
+void lexer_tables_init(void)
+{
+    static bool initialized = false;
+    if (initialized) {
+        return;
+    }
+    initialized = true;
+
+    for (int c = 0; c < 256; ++c) {
+        lexer_classes[c] = c == '"' ? 0 : LEXER_STRING;
+        lexer_tokens[c] = TOKEN_ILLEGAL;
+        lexer_tokens_equal[c] = TOKEN_NONE;
+        if (c == ' ' || (c >= '\t' && c <= '\r')) {
+            lexer_classes[c] |= LEXER_SPACE;
+        } else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+            lexer_classes[c] |= LEXER_ALPHA | LEXER_IDENTIFIER;
+            lexer_tokens[c] = TOKEN_IDENTIFIER;
+        } else if (c >= '0' && c <= '9') {
+            lexer_classes[c] |= LEXER_DIGIT | LEXER_IDENTIFIER;
+            lexer_tokens[c] = TOKEN_INTEGER;
+        } else if (c == '_') {
+            lexer_classes[c] |= LEXER_IDENTIFIER;
+        }
+    }
+
+    lexer_tokens['"'] = TOKEN_STRING;
+    lexer_tokens['='] = TOKEN_ASSIGN;
+    lexer_tokens['>'] = TOKEN_GREATER;
+    lexer_tokens['<'] = TOKEN_LESS;
+    lexer_tokens['!'] = TOKEN_NOT;
+    lexer_tokens['+'] = TOKEN_PLUS;
+    lexer_tokens['-'] = TOKEN_MINUS;
+    lexer_tokens['*'] = TOKEN_MULTIPLY;
+    lexer_tokens['/'] = TOKEN_DIVIDE;
+    lexer_tokens[','] = TOKEN_COMMA;
+    lexer_tokens[':'] = TOKEN_COLON;
+    lexer_tokens[';'] = TOKEN_SEMICOLON;
+    lexer_tokens['('] = TOKEN_LEFT_PAREN;
+    lexer_tokens['{'] = TOKEN_LEFT_BRACE;
+    lexer_tokens['['] = TOKEN_LEFT_BRACKET;
+    lexer_tokens[')'] = TOKEN_RIGHT_PAREN;
+    lexer_tokens['}'] = TOKEN_RIGHT_BRACE;
+    lexer_tokens[']'] = TOKEN_RIGHT_BRACKET;
+
+    lexer_tokens_equal['='] = TOKEN_EQUAL;
+    lexer_tokens_equal['>'] = TOKEN_GREATER_EQUAL;
+    lexer_tokens_equal['<'] = TOKEN_LESS_EQUAL;
+    lexer_tokens_equal['!'] = TOKEN_NOT_EQUAL;
+}
+
+/*
+ * Read the remaining input of a file that cannot be mapped, such as a pipe,
+ * into a buffer that grows as needed.
+ */
+char* lexer_read(FILE* file, size_t* size)
+{
+    size_t capacity = 4096;
+    char* buffer = (char*)malloc(capacity);
+    *size = 0;
+    while (true) {
+        *size += fread(buffer + *size, 1, capacity - *size, file);
+        if (*size < capacity) {
+            break;
+        }
+        capacity *= 2;
+        buffer = (char*)realloc(buffer, capacity);
+    }
+    return buffer;
+}
+
 void lexer_init(Lexer* lexer, FILE* file)
 {
-    lexer->file = file;
+    lexer->source = NULL;
+    lexer->size = 0;
+    lexer->offset = 0;
     lexer->line = 0;
-    lexer->position = 0;
-    lexer->pushed = false;
+    lexer->line_offset = -1; // positions on the first line are counted from one
+    lexer->mapped = false;
+    lexer->descriptor = -1;
+    lexer->capacity = 0;
+    lexer->start = 0;
+    lexer->mark = 0;
+    lexer->discarded = 0;
+    lexer_tables_init();
+
+    struct stat status;
+    if (fstat(fileno(file), &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0) {
+        void* source = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+        if (source != MAP_FAILED) {
+            lexer->source = (const char*)source;
+            lexer->size = (size_t)status.st_size;
+            lexer->mapped = true;
+            return;
+        }
+    }
+    lexer->source = lexer_read(file, &lexer->size);
 }
 
-int lexer_pop_char(Lexer* lexer)
+/*
+ * Set up a lexer that reads its source from the file only as it is scanned,
+ * so that tokens are returned as soon as their input is available.
+ */
+void lexer_init_stream(Lexer* lexer, FILE* file)
 {
-    if (lexer->pushed) {
-        lexer->pushed = false;
-        return lexer->push;
+    lexer_init_range(lexer, lexer, &(LexerRange) { 0, 0, 0, -1 });
+    lexer->source = (const char*)malloc(LEXER_BUFFER_SIZE);
+    lexer->descriptor = fileno(file);
+    lexer->capacity = LEXER_BUFFER_SIZE;
+    lexer_tables_init();
+}
+
+/*
+ * Read more of the source of a streaming lexer. The source preceding the last
+ * token returned is discarded first, and the buffer only grows when a single
+ * token does not fit in it.
+ */
+bool lexer_fill(Lexer* lexer)
+{
+    if (lexer->descriptor < 0) {
+        return false;
     }
 
-    int c = fgetc(lexer->file);
-    if (c == '\n') {
-        lexer->line++;
-        lexer->position = -1; // next char after newline is 0
-    } else {
-        lexer->position += 1;
+    char* source = (char*)lexer->source;
+    size_t mark = lexer->mark;
+    if (mark > 0) {
+        memmove(source, source + mark, lexer->size - mark);
+        lexer->size -= mark;
+        lexer->offset -= mark;
+        lexer->start -= mark;
+        lexer->line_offset -= (ssize_t)mark;
+        lexer->mark = 0;
+        lexer->discarded += mark;
+    }
+    if (lexer->size == lexer->capacity) {
+        lexer->capacity *= 2;
+        source = (char*)realloc(source, lexer->capacity);
+        lexer->source = source;
+    }
+
+    ssize_t size;
+    do {
+        size = read(lexer->descriptor, source + lexer->size, lexer->capacity - lexer->size);
+    } while (size < 0 && errno == EINTR);
+    if (size <= 0) {
+        lexer->descriptor = -1;
+        return false;
     }
-    return c;
+    lexer->size += (size_t)size;
+    return true;
 }
 
-void lexer_push_char(Lexer* lexer, int c)
+/*
+ * Lex a range of the source held by another lexer. The source is shared with
+ * that lexer, which must outlive this one, and this lexer must not be freed.
+ */
+void lexer_init_range(Lexer* lexer, const Lexer* source, const LexerRange* range)
 {
-    lexer->pushed = true;
-    lexer->push = c;
+    lexer_init_buffer(lexer, source->source, range);
 }
 
-void lexer_token_start(Lexer* lexer, Token* token, TokenType type)
+/*
+ * Lex a range of a source held in a buffer owned by the caller.
+ */
+void lexer_init_buffer(Lexer* lexer, const char* source, const LexerRange* range)
 {
-    token->type = type;
-    token->line = lexer->line;
-    token->position = lexer->position;
+    lexer->source = source;
+    lexer->size = range->end;
+    lexer->offset = range->start;
+    lexer->line = range->line;
+    lexer->line_offset = range->line_offset;
+    lexer->mapped = false;
+    lexer->descriptor = -1;
+    lexer->capacity = 0;
+    lexer->start = range->start;
+    lexer->mark = range->start;
+    lexer->discarded = 0;
+}
+
+/*
+ * Split the source into at most the given number of ranges of similar size.
+ * Ranges only end after a semicolon outside of any parentheses, braces,
+ * brackets, strings and comments, which is where a top level statement ends.
+ * This is a single pass over the characters that is much cheaper than lexing.
+ */
+size_t lexer_split(const Lexer* lexer, LexerRange* ranges, size_t count)
+{
+    const char* source = lexer->source;
+    size_t size = lexer->size;
+    size_t target = size / count;
+    size_t line = 0;
+    ssize_t line_offset = -1;
+    long depth = 0;
+
+    size_t ranges_size = 0;
+    LexerRange range = { 0, size, line, line_offset };
+    for (size_t i = 0; i < size; ++i) {
+        switch (source[i]) {
+        case '\n':
+            line++;
+            line_offset = (ssize_t)i + 1;
+            break;
+        case '"':
+            for (++i; i < size && source[i] != '"'; ++i) {
+                if (source[i] == '\n') {
+                    line++;
+                    line_offset = (ssize_t)i + 1;
+                }
+            }
+            break;
+        case '/':
+            if (i + 1 < size && source[i + 1] == '/') {
+                const char* end = memchr(source + i, '\n', size - i);
+                // the newline ending the comment is counted on the next iteration
+                i = end == NULL ? size : (size_t)(end - source) - 1;
+            }
+            break;
+        case '(':
+        case '{':
+        case '[':
+            depth++;
+            break;
+        case ')':
+        case '}':
+        case ']':
+            depth--;
+            break;
+        case ';':
+            if (depth == 0 && i + 1 - range.start >= target && ranges_size + 1 < count) {
+                range.end = i + 1;
+                ranges[ranges_size++] = range;
+                range = (LexerRange) { i + 1, size, line, line_offset };
+            }
+            break;
+        }
+    }
+    ranges[ranges_size++] = range;
+    return ranges_size;
 }
 
-bool lexer_token_next_aux(Lexer* lexer, Token* token)
+/*
+ * Restart scanning from the beginning of the source.
+ */
+void lexer_reset(Lexer* lexer)
 {
-    int c;
-next:
-    /*
-     * Some tokens span multiple input characters. The lexer must "look ahead"
-     * to subsequent input characters to determine if the end of the token has
-     * occurred. Handle the case where tokens in this class are terminated by
-     * reaching the end of the input file.
-     */
-    if ((c = lexer_pop_char(lexer)) != EOF) {
-
-    } else if (token->type == TOKEN_NONE || token->type == TOKEN_COMMENT) {
-        lexer_token_start(lexer, token, TOKEN_END);
-        return true;
-    } else if (token->type == TOKEN_IDENTIFIER) {
-        return true;
-    } else if (token->type == TOKEN_INTEGER) {
-        return true;
-    } else if (token->type == TOKEN_ASSIGN) {
-        return true;
-    } else if (token->type == TOKEN_DIVIDE) {
-        return true;
-    } else if (token->type == TOKEN_GREATER) {
-        return true;
-    } else if (token->type == TOKEN_LESS) {
-        return true;
+    lexer->offset = 0;
+    lexer->line = 0;
+    lexer->line_offset = -1;
+}
+
+void lexer_free(Lexer* lexer)
+{
+    if (lexer->mapped) {
+        munmap((void*)lexer->source, lexer->size);
     } else {
-        token->type = TOKEN_ILLEGAL;
-        return false;
+        free((void*)lexer->source);
     }
+}
 
-    /*
-     * Discard whitespace characters that occur outside the context of an
-     * established token type.
-     */
-    if (token->type == TOKEN_NONE && isspace(c)) {
-        goto next;
+int lexer_peek(Lexer* lexer, size_t ahead)
+{
+    while (lexer->offset + ahead >= lexer->size) {
+        if (!lexer_fill(lexer)) {
+            return EOF;
+        }
     }
+    return (unsigned char)lexer->source[lexer->offset + ahead];
+}
 
-    /*
-     * Check for the quote character starting a string token before extending
-     * the current lexeme. Note that the terminating quote character is excluded
-     * from the lexeme below.
-     */
-    if (token->type == TOKEN_NONE && c == '"') {
-        lexer_token_start(lexer, token, TOKEN_STRING);
-        goto next;
+void lexer_advance(Lexer* lexer)
+{
+    if (lexer->source[lexer->offset++] == '\n') {
+        lexer->line++;
+        lexer->line_offset = (ssize_t)lexer->offset;
     }
+}
 
-    /*
-     * Check for the termination of tokens that "look ahead" due to conditions
-     * other than having reached the end of the input.
-     *
-     * Note that comments are excluded from the token stream of the lexer. Note
-     * also that the terminal quote character of a string token is excluded from
-     * the corresponding lexeme.
-     */
-    if (token->type == TOKEN_COMMENT && c == '\n') {
-        token_reset(token);
-        goto next;
-    } else if (token->type == TOKEN_IDENTIFIER && !isalnum(c) && c != '_') {
-        lexer_push_char(lexer, c);
-        return true;
-    } else if (token->type == TOKEN_INTEGER && !isdigit(c)) {
-        lexer_push_char(lexer, c);
-        return true;
-    } else if (token->type == TOKEN_STRING && c == '"') {
-        return true;
-    } else if (token->type == TOKEN_ASSIGN && c != '=') {
-        lexer_push_char(lexer, c);
-        return true;
-    } else if (token->type == TOKEN_DIVIDE && c != '/') {
-        lexer_push_char(lexer, c);
-        return true;
-    } else if (token->type == TOKEN_GREATER && c != '=') {
-        lexer_push_char(lexer, c);
-        return true;
-    } else if (token->type == TOKEN_LESS && c != '=') {
-        lexer_push_char(lexer, c);
-        return true;
-    } else if (token->type == TOKEN_NOT && c != '=') {
-        lexer_push_char(lexer, c);
-        return true;
+#ifdef __SSE2__
+__m128i lexer_range(__m128i characters, char first, char last)
+{
+    __m128i above = _mm_cmpgt_epi8(characters, _mm_set1_epi8((char)(first - 1)));
+    __m128i below = _mm_cmplt_epi8(characters, _mm_set1_epi8((char)(last + 1)));
+    return _mm_and_si128(above, below);
+}
+
+/*
+ * Compute a bit mask of the characters in a block of sixteen that belong to a
+ * class. Characters outside of ASCII compare as negative and never match a
+ * range.
+ */
+unsigned int lexer_match(__m128i characters, uint8_t class)
+{
+    __m128i match;
+    if (class == LEXER_SPACE) {
+        match = _mm_or_si128(_mm_cmpeq_epi8(characters, _mm_set1_epi8(' ')), lexer_range(characters, '\t', '\r'));
+    } else if (class == LEXER_DIGIT) {
+        match = lexer_range(characters, '0', '9');
+    } else if (class == LEXER_IDENTIFIER) {
+        match = _mm_or_si128(lexer_range(characters, 'a', 'z'), lexer_range(characters, 'A', 'Z'));
+        match = _mm_or_si128(match, lexer_range(characters, '0', '9'));
+        match = _mm_or_si128(match, _mm_cmpeq_epi8(characters, _mm_set1_epi8('_')));
+    } else {
+        match = _mm_cmpeq_epi8(characters, _mm_set1_epi8('"'));
+        return ~(unsigned int)_mm_movemask_epi8(match) & 0xffff;
     }
+    return (unsigned int)_mm_movemask_epi8(match);
+}
+#endif
+
+/*
+ * Advance over a run of characters of a single class. Blocks of sixteen
+ * characters are matched at once where SSE2 is available, counting any
+ * newlines they contain, and the remainder is matched one at a time.
+ */
+void lexer_scan_buffer(Lexer* lexer, uint8_t class)
+{
+#ifdef __SSE2__
+    while (lexer->offset + 16 <= lexer->size) {
+        __m128i characters = _mm_loadu_si128((const __m128i*)(lexer->source + lexer->offset));
+        unsigned int match = lexer_match(characters, class);
+        unsigned int count = match == 0xffff ? 16 : (unsigned int)__builtin_ctz(~match);
+
+        unsigned int newlines = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(characters, _mm_set1_epi8('\n')));
+        newlines &= (1u << count) - 1;
+        if (newlines != 0) {
+            lexer->line += (size_t)__builtin_popcount(newlines);
+            lexer->line_offset = (ssize_t)(lexer->offset + 32 - (size_t)__builtin_clz(newlines));
+        }
 
-    token_append(token, c);
-
-    /*
-     * Process the next character for the "look ahead" tokens. Note that the
-     * termination conditions for these tokens were all checked above. Here it
-     * is safe to assume that the current character is a valid extension of the
-     * corresponding lexeme. Note that some token lexemes are suffixes of others
-     * so token types may change in some cases.
-     */
-    if (token->type == TOKEN_COMMENT) {
-        goto next;
-    } else if (token->type == TOKEN_IDENTIFIER) {
-        goto next;
-    } else if (token->type == TOKEN_INTEGER) {
-        goto next;
-    } else if (token->type == TOKEN_STRING) {
-        goto next;
-    } else if (token->type == TOKEN_ASSIGN) {
-        token->type = TOKEN_EQUAL;
-        return true;
-    } else if (token->type == TOKEN_DIVIDE) {
-        token->type = TOKEN_COMMENT;
-        goto next;
-    } else if (token->type == TOKEN_GREATER) {
-        token->type = TOKEN_GREATER_EQUAL;
-        return true;
-    } else if (token->type == TOKEN_LESS) {
-        token->type = TOKEN_LESS_EQUAL;
-        return true;
-    } else if (token->type == TOKEN_NOT) {
-        token->type = TOKEN_NOT_EQUAL;
-        return true;
+        lexer->offset += count;
+        if (count < 16) {
+            return;
+        }
+    }
+#endif
+    while (lexer->offset < lexer->size && (lexer_classes[(unsigned char)lexer->source[lexer->offset]] & class)) {
+        lexer_advance(lexer);
     }
+}
 
-    /*
-     * Handle the start of new tokens. The current character uniquely identifies
-     * the possible token types that can follow. Note that language keywords are
-     * indistinguishable from identifiers until the end of the token is reached.
-     * Token processing treats all as identifiers and checks for matching
-     * keywords just before returning.
-     */
-    if (isalpha(c)) {
-        lexer_token_start(lexer, token, TOKEN_IDENTIFIER);
-        goto next;
-    } else if (isdigit(c)) {
-        lexer_token_start(lexer, token, TOKEN_INTEGER);
-        goto next;
+/*
+ * Scan a run of characters, reading more of the source of a streaming lexer
+ * whenever the run reaches the end of what has been read so far.
+ */
+void lexer_scan(Lexer* lexer, uint8_t class)
+{
+    do {
+        lexer_scan_buffer(lexer, class);
+    } while (lexer->offset == lexer->size && lexer_fill(lexer));
+}
+
+/*
+ * Discard whitespace and comments preceding the next token. Comments extend
+ * from a double slash to the end of the line.
+ */
+void lexer_skip(Lexer* lexer)
+{
+    while (true) {
+        lexer_scan(lexer, LEXER_SPACE);
+        if (lexer_peek(lexer, 0) != '/' || lexer_peek(lexer, 1) != '/') {
+            return;
+        }
+
+        const char* end;
+        do {
+            end = memchr(lexer->source + lexer->offset, '\n', lexer->size - lexer->offset);
+            lexer->offset = end == NULL ? lexer->size : (size_t)(end - lexer->source);
+        } while (end == NULL && lexer_fill(lexer));
     }
+}
 
-    switch (c) {
-    case '=':
-        lexer_token_start(lexer, token, TOKEN_ASSIGN);
-        goto next;
-    case '+':
-        lexer_token_start(lexer, token, TOKEN_PLUS);
-        return true;
-    case '-':
-        lexer_token_start(lexer, token, TOKEN_MINUS);
-        return true;
-    case '*':
-        lexer_token_start(lexer, token, TOKEN_MULTIPLY);
-        return true;
-    case '/':
-        lexer_token_start(lexer, token, TOKEN_DIVIDE);
-        goto next;
-    case '>':
-        lexer_token_start(lexer, token, TOKEN_GREATER);
-        goto next;
-    case '<':
-        lexer_token_start(lexer, token, TOKEN_LESS);
-        goto next;
-    case '!':
-        lexer_token_start(lexer, token, TOKEN_NOT);
-        goto next;
-    case ',':
-        lexer_token_start(lexer, token, TOKEN_COMMA);
-        return true;
-    case ':':
-        lexer_token_start(lexer, token, TOKEN_COLON);
-        return true;
-    case ';':
-        lexer_token_start(lexer, token, TOKEN_SEMICOLON);
-        return true;
-    case '(':
-        lexer_token_start(lexer, token, TOKEN_LEFT_PAREN);
-        return true;
-    case '{':
-        lexer_token_start(lexer, token, TOKEN_LEFT_BRACE);
-        return true;
-    case '[':
-        lexer_token_start(lexer, token, TOKEN_LEFT_BRACKET);
-        return true;
-    case ')':
-        lexer_token_start(lexer, token, TOKEN_RIGHT_PAREN);
-        return true;
-    case '}':
-        lexer_token_start(lexer, token, TOKEN_RIGHT_BRACE);
-        return true;
-    case ']':
-        lexer_token_start(lexer, token, TOKEN_RIGHT_BRACKET);
-        return true;
-    default:
-        lexer_token_start(lexer, token, TOKEN_ILLEGAL);
-        return false;
+/*
+ * The lexeme of a token is only located once the token is complete, since the
+ * buffer of a streaming lexer may move while the token is scanned.
+ */
+void lexer_token_start(Lexer* lexer, Token* token, TokenType type)
+{
+    token->type = type;
+    token->line = lexer->line;
+    token->position = (ssize_t)lexer->offset - lexer->line_offset;
+    lexer->start = lexer->offset;
+}
+
+void lexer_token_end(Lexer* lexer, Token* token)
+{
+    token->lexeme = lexer->source + lexer->start;
+    token->length = lexer->offset - lexer->start;
+}
+
+/*
+ * Keywords are matched exactly by their length and a perfect hash of their
+ * first and last characters, so that identifiers merely starting with a
+ * keyword remain identifiers.
+ */
+typedef struct LexerKeyword LexerKeyword;
+struct LexerKeyword {
+    const char* name;
+    size_t length;
+    TokenType type;
+};
+
+static const LexerKeyword lexer_keywords[8] = {
+    { "return", 6, TOKEN_RETURN },
+    { "true", 4, TOKEN_TRUE },
+    { "if", 2, TOKEN_IF },
+    { "else", 4, TOKEN_ELSE },
+    { "fn", 2, TOKEN_FUNCTION },
+    { NULL, 0, TOKEN_NONE },
+    { "false", 5, TOKEN_FALSE },
+    { "let", 3, TOKEN_LET },
+};
+
+TokenType lexer_keyword(const Token* token)
+{
+    size_t length = token->length;
+    const char* lexeme = token->lexeme;
+    const LexerKeyword* keyword = &lexer_keywords[(2 * (unsigned char)lexeme[0] + (unsigned char)lexeme[length - 1] + length) & 7];
+    if (keyword->length == length && memcmp(keyword->name, lexeme, length) == 0) {
+        return keyword->type;
+    }
+    return TOKEN_IDENTIFIER;
+}
+
+/*
+ * The lexeme of a string token excludes the quote characters. A string that
+ * is not terminated before the end of the input is an illegal token.
+ */
+void lexer_token_string(Lexer* lexer, Token* token)
+{
+    lexer->start = ++lexer->offset;
+    lexer_scan(lexer, LEXER_STRING);
+    lexer_token_end(lexer, token);
+    if (lexer->offset >= lexer->size) {
+        token->type = TOKEN_ILLEGAL;
+    } else {
+        lexer->offset++;
     }
 }
 
 Token lexer_token_next(Lexer* lexer)
 {
     Token token;
-    token_init(&token, lexer->line, lexer->position);
+    token_init(&token, lexer->line, 0);
 
-    if (feof(lexer->file)) {
+    lexer_skip(lexer);
+    int c = lexer_peek(lexer, 0);
+    if (c == EOF) {
         lexer_token_start(lexer, &token, TOKEN_END);
-        return token;
-    } else if (!lexer_token_next_aux(lexer, &token)) {
-        return token;
-    } else if (token.type != TOKEN_IDENTIFIER) {
+        lexer_token_end(lexer, &token);
+        lexer->mark = lexer->start;
         return token;
     }
 
-    /*
-     * Compare identifier tokens to language keywords and convert to appropriate
-     * keyword tokens if a match is found.
-     */
-    if (strncmp(token.lexeme.value, "let", 3) == 0) {
-        token.type = TOKEN_LET;
-    } else if (strncmp(token.lexeme.value, "if", 2) == 0) {
-        token.type = TOKEN_IF;
-    } else if (strncmp(token.lexeme.value, "else", 4) == 0) {
-        token.type = TOKEN_ELSE;
-    } else if (strncmp(token.lexeme.value, "fn", 2) == 0) {
-        token.type = TOKEN_FUNCTION;
-    } else if (strncmp(token.lexeme.value, "return", 6) == 0) {
-        token.type = TOKEN_RETURN;
-    } else if (strncmp(token.lexeme.value, "true", 4) == 0) {
-        token.type = TOKEN_TRUE;
-    } else if (strncmp(token.lexeme.value, "false", 5) == 0) {
-        token.type = TOKEN_FALSE;
+    lexer_token_start(lexer, &token, lexer_tokens[c]);
+    switch (token.type) {
+    case TOKEN_IDENTIFIER:
+        lexer_scan(lexer, LEXER_IDENTIFIER);
+        lexer_token_end(lexer, &token);
+        token.type = lexer_keyword(&token);
+        break;
+    case TOKEN_INTEGER:
+        lexer_scan(lexer, LEXER_DIGIT);
+        lexer_token_end(lexer, &token);
+        break;
+    case TOKEN_STRING:
+        lexer_token_string(lexer, &token);
+        break;
+    default:
+        lexer->offset++;
+        if (lexer_tokens_equal[c] != TOKEN_NONE && lexer_peek(lexer, 0) == '=') {
+            token.type = lexer_tokens_equal[c];
+            lexer->offset++;
+        }
+        lexer_token_end(lexer, &token);
+        break;
     }
+    lexer->mark = lexer->start;
     return token;
 }
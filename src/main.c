@@ -1,16 +1,49 @@
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
+#include "monkey/cache.h"
+#include "monkey/closure.h"
+#include "monkey/document.h"
 #include "monkey/error.h"
 #include "monkey/eval.h"
+#include "monkey/hashcons.h"
+#include "monkey/infer.h"
 #include "monkey/lexer.h"
+#include "monkey/optimizer.h"
 #include "monkey/parser.h"
+#include "monkey/resolver.h"
+#include "monkey/symbol.h"
+#include "monkey/vm.h"
+
+/*
+ * Time a pass of the lexer over the whole source, without printing any tokens,
+ * and report its throughput on the standard error stream.
+ */
+void tokenize_measure(Lexer* lexer)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Token token;
+    do {
+        token = lexer_token_next(lexer);
+    } while (token.type != TOKEN_END && token.type != TOKEN_ILLEGAL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    double megabytes = (double)lexer->offset / (1024.0 * 1024.0);
+    fprintf(stderr, "tokenized %.2f MB in %.6f s (%.2f MB/s)\n", megabytes, seconds, seconds > 0 ? megabytes / seconds : 0.0);
+    lexer_reset(lexer);
+}
 
 bool tokenize(FILE* file)
 {
     Lexer lexer;
     lexer_init(&lexer, file);
+    tokenize_measure(&lexer);
     bool stop = false;
     while (!stop) {
         Token token = lexer_token_next(&lexer);
@@ -18,24 +51,139 @@ bool tokenize(FILE* file)
             stop = true;
         } else if (token.type == TOKEN_ILLEGAL) {
             stop = true;
-            printf("unrecognized token: %s\n", token.lexeme.value);
+            printf("unrecognized token: %.*s\n", (int)token.length, token.lexeme);
         } else {
             token_print(&token);
         }
-        token_free(&token);
     }
+    lexer_free(&lexer);
     return true;
 }
 
+/*
+ * The number of threads parsing the program, where a single thread parses it
+ * sequentially.
+ */
+static size_t jobs = 1;
+
+/*
+ * The path of the cache of the parsed program, if caching is enabled.
+ */
+static String cache;
+
+/*
+ * Whether eval parses function bodies only when they are first called. The
+ * cache holds fully parsed programs, so this has no effect when it is enabled.
+ */
+static bool lazy = false;
+
+/*
+ * Whether eval runs the program compiled into closures rather than walking its
+ * tree. Function bodies are then always parsed up front.
+ */
+static bool closures = false;
+
+/*
+ * Whether the parsed program is optimized before it is printed or evaluated.
+ * An optimized program is also type checked before it is evaluated.
+ */
+static bool optimizing = false;
+
+/*
+ * Whether identical immutable subtrees of the parsed program are shared, and
+ * the canonical copies they share, which outlive the program.
+ */
+static bool sharing = false;
+static HashCons hashcons;
+
+/*
+ * The edits applied to the source by parse, each given as the offset and
+ * length of the replaced text followed by the text replacing it.
+ */
+static const char** edits = NULL;
+static size_t edits_size = 0;
+
+bool program_parse(Parser* parser, StatementBlock* block)
+{
+    const char* path = string_value(&cache);
+    bool result = path != NULL && cache_load(path, &parser->lexer, &parser->arena, parser->constants, block);
+    if (!result) {
+        if (jobs > 1) {
+            result = parser_parse_program_parallel(parser, block, jobs);
+        } else {
+            result = parser_parse_program(parser, block);
+        }
+        if (result && path != NULL) {
+            cache_store(path, &parser->lexer, block);
+        }
+    }
+
+    if (result && optimizing) {
+        optimize_program(block, parser->constants, &parser->arena);
+    }
+    if (result && sharing) {
+        hashcons_program(&hashcons, block);
+    }
+    return result;
+}
+
+/*
+ * Parse the source, then apply each edit in turn and parse again only what it
+ * touched, reporting the time taken by each edit on the standard error stream.
+ */
+bool parse_edited(FILE* file)
+{
+    Lexer lexer;
+    lexer_init(&lexer, file);
+    Document document;
+    document_init(&document, lexer.source, lexer.size);
+    lexer_free(&lexer);
+
+    for (size_t i = 0; i < edits_size; ++i) {
+        char* text;
+        size_t offset = strtoul(edits[i], &text, 10);
+        size_t length = *text == ',' ? strtoul(text + 1, &text, 10) : 0;
+        text = *text == ',' ? text + 1 : text;
+
+        if (offset > document.size || length > document.size - offset) {
+            printf("Invalid edit: %s\n", edits[i]);
+            document_free(&document);
+            return false;
+        }
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        document_edit(&document, offset, length, text, strlen(text));
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+        fprintf(stderr, "edited %zu characters at %zu in %.6f s\n", length, offset, seconds);
+    }
+
+    bool result = document.error.type == ERROR_NONE;
+    if (result) {
+        statement_block_print(&document.program, 0);
+    } else {
+        error_print(&document.error);
+    }
+    document_free(&document);
+
+    return result;
+}
+
 bool parse(FILE* file)
 {
+    if (edits_size > 0) {
+        return parse_edited(file);
+    }
+
     Parser parser;
     parser_init(&parser, file);
 
     StatementBlock block;
     statement_block_init(&block);
 
-    bool result = parser_parse_program(&parser, &block);
+    bool result = program_parse(&parser, &block);
     if (result) {
         statement_block_print(&block, 0);
     } else {
@@ -52,47 +200,280 @@ bool eval(FILE* file)
 {
     Parser parser;
     parser_init(&parser, file);
+    parser.lazy = lazy && string_value(&cache) == NULL && !closures;
 
     StatementBlock block;
     statement_block_init(&block);
 
-    bool result = parser_parse_program(&parser, &block);
-    if (result) {
+    bool result = program_parse(&parser, &block);
+    if (result && resolve_program(&block)) {
+        // a type error the program is certain to reach stops it before it runs
+        bool typed = !optimizing || infer_program(&block);
+        if (typed && closures) {
+            closure_execute_program(&block);
+        } else if (typed) {
+            evaluate_program(&block);
+        }
+    } else {
+        error_print(&parser.error);
+    }
+
+    statement_block_free(&block);
+    parser_free(&parser);
+
+    return result;
+}
+
+bool vm(FILE* file)
+{
+    Parser parser;
+    parser_init(&parser, file);
+
+    StatementBlock block;
+    statement_block_init(&block);
+
+    bool result = program_parse(&parser, &block);
+    if (result && resolve_program(&block)) {
+        vm_execute_program(&block);
+    } else {
+        error_print(&parser.error);
+    }
+
+    statement_block_free(&block);
+    parser_free(&parser);
+
+    return result;
+}
+
+/*
+ * Evaluate each top level statement as soon as it has been parsed. The tree of
+ * a statement is released after its evaluation, unless the statement defines a
+ * function, since function objects keep referring to their definition. The
+ * arena of the parser is rolled back over released statements, so that kept
+ * ones are packed together. Free names in functions are looked up
+ * dynamically, as later statements may bind them in any scope.
+ */
+bool stream(FILE* file)
+{
+    Parser parser;
+    parser_init_stream(&parser, file);
+
+    // the global scope and the statements kept for their functions
+    StatementBlock program;
+    statement_block_init(&program);
+
+    Resolver resolver;
+    resolver_init(&resolver, &program.scope);
+    resolver.incremental = true;
+    resolver_bind_internal(&resolver);
+
+    Stack stack;
+    stack_init(&stack);
+    Environment environment;
+    evaluate_program_init(&environment, &program.scope, &stack);
+
+    Statement statement;
+    ArenaMark mark = arena_mark(&parser.arena);
+    while (parser_parse_program_next(&parser, &statement)) {
+        // statements are evaluated in place, where function objects refer to them
+        Statement* tail = program.tail;
+        statement_block_extend(&program, &parser.arena, &statement);
+        Statement* current = program.tail;
+
+        bool result = resolve_statement(&resolver, current) && evaluate_program_statement(&environment, current);
+        if (!expression_contains_function(&current->expression)) {
+            statement_free(current);
+            program.tail = tail;
+            if (tail == NULL) {
+                program.head = NULL;
+            } else {
+                tail->next = NULL;
+            }
+            arena_release(&parser.arena, mark);
+        }
+        mark = arena_mark(&parser.arena);
+        fflush(stdout);
+        if (!result) {
+            break;
+        }
+    }
+
+    bool result = parser.error.type == ERROR_NONE;
+    if (!result) {
+        error_print(&parser.error);
+    }
+
+    environment_free(&environment);
+    stack_free(&stack);
+    resolver_free(&resolver);
+    statement_block_free(&program);
+    parser_free(&parser);
+
+    return result;
+}
+
+/*
+ * Write a machine generated program of the given number of top level
+ * statements. It ends with a function, never called, whose body is a chain of
+ * as many operators followed by a call with as many arguments.
+ */
+void stress_generate(FILE* file, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        switch (i % 4) {
+        case 0:
+            fprintf(file, "let v%zu = %zu;\n", i, i % 1000);
+            break;
+        case 1:
+            fprintf(file, "let v%zu = v%zu * 2 + %zu;\n", i, i - 1, i % 1000);
+            break;
+        case 2:
+            fprintf(file, "let v%zu = fn(a, b) { if (a < b) { a } else { b } };\n", i);
+            break;
+        default:
+            fprintf(file, "let v%zu = v%zu(v%zu, len(\"s%zu\"));\n", i, i - 1, i - 2, i);
+            break;
+        }
+    }
+    fprintf(file, "let deep = fn() {\n    v0");
+    for (size_t i = 0; i < count; ++i) {
+        fprintf(file, " + v%zu", (i / 4) * 4);
+    }
+    fprintf(file, ";\n    puts(v0");
+    for (size_t i = 0; i < count; ++i) {
+        fprintf(file, ", v%zu", (i / 4) * 4);
+    }
+    fprintf(file, ")\n};\n");
+}
+
+double stress_seconds(struct timespec* start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start->tv_sec) + (double)(end.tv_nsec - start->tv_nsec) / 1e9;
+    *start = end;
+    return seconds;
+}
+
+/*
+ * Time each phase of running a generated program of the given number of
+ * statements, on the standard error stream. None of the phases may use stack
+ * space in proportion to the size of the program.
+ */
+bool stress(size_t count)
+{
+    FILE* file = tmpfile();
+    if (file == NULL) {
+        printf("Error creating temporary file\n");
+        return false;
+    }
+    stress_generate(file, count);
+    rewind(file);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Parser parser;
+    parser_init(&parser, file);
+    StatementBlock block;
+    statement_block_init(&block);
+    bool result = jobs > 1 ? parser_parse_program_parallel(&parser, &block, jobs) : parser_parse_program(&parser, &block);
+    fprintf(stderr, "parsed %zu statements in %.6f s\n", count + 1, stress_seconds(&start));
+
+    if (result && resolve_program(&block)) {
+        fprintf(stderr, "resolved in %.6f s\n", stress_seconds(&start));
         evaluate_program(&block);
+        fprintf(stderr, "evaluated in %.6f s\n", stress_seconds(&start));
     } else {
         error_print(&parser.error);
     }
 
     statement_block_free(&block);
     parser_free(&parser);
+    fprintf(stderr, "freed in %.6f s\n", stress_seconds(&start));
+    fclose(file);
 
     return result;
 }
 
 int main(int argc, char* argv[])
 {
-    if (argc != 3) {
-        printf("Usage: %s command file\n", argv[0]);
+    // a job count of zero uses every online processor
+    bool caching = false;
+    static const struct option options[] = {
+        { "closures", no_argument, NULL, 'C' },
+        { "optimized", no_argument, NULL, 'O' },
+        { NULL, 0, NULL, 0 },
+    };
+    int option;
+    while ((option = getopt_long(argc, argv, "Cce:j:lOs", options, NULL)) != -1) {
+        if (option == 'C') {
+            closures = true;
+        } else if (option == 'c') {
+            caching = true;
+        } else if (option == 'e') {
+            edits = (const char**)realloc(edits, (edits_size + 1) * sizeof(const char*));
+            edits[edits_size++] = optarg;
+        } else if (option == 'l') {
+            lazy = true;
+        } else if (option == 'O') {
+            optimizing = true;
+        } else if (option == 's') {
+            sharing = true;
+        } else if (option == 'j') {
+            long count = strtol(optarg, NULL, 10);
+            jobs = count > 0 ? (size_t)count : (size_t)sysconf(_SC_NPROCESSORS_ONLN);
+        } else {
+            exit(1);
+        }
+    }
+
+    if (argc - optind != 2) {
+        printf("Usage: %s [-C|--closures] [-c] [-e offset,length,text] [-j jobs] [-l] [-O|--optimized] [-s] command file\n", argv[0]);
         exit(1);
     }
+    const char* command = argv[optind];
+    const char* path = argv[optind + 1];
 
-    FILE* file = fopen(argv[2], "r");
+    // the stress benchmark takes a number of statements in place of a file
+    if (strcmp(command, "stress") == 0) {
+        bool result = stress((size_t)strtoul(path, NULL, 10));
+        free(edits);
+        symbol_table_free();
+        return result ? 0 : 1;
+    }
+
+    // a path of - reads the program from the standard input
+    FILE* file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
     if (file == NULL) {
-        printf("Error opening file: %s\n", argv[2]);
+        printf("Error opening file: %s\n", path);
         exit(1);
     }
 
+    string_init(&cache);
+    hashcons_init(&hashcons);
+    if (caching) {
+        cache_path(&cache, path);
+    }
+
     bool result = true;
-    if (strncmp(argv[1], "tokenize", 8) == 0) {
+    if (strncmp(command, "tokenize", 8) == 0) {
         result = tokenize(file);
-    } else if (strncmp(argv[1], "parse", 5) == 0) {
+    } else if (strncmp(command, "parse", 5) == 0) {
         result = parse(file);
-    } else if (strncmp(argv[1], "eval", 4) == 0) {
+    } else if (strncmp(command, "eval", 4) == 0) {
         result = eval(file);
+    } else if (strncmp(command, "vm", 2) == 0) {
+        result = vm(file);
+    } else if (strncmp(command, "stream", 6) == 0) {
+        result = stream(file);
     } else {
-        printf("Unrecognized command: %s\n", argv[1]);
+        printf("Unrecognized command: %s\n", command);
         exit(1);
     }
+    string_free(&cache);
+    hashcons_free(&hashcons);
+    free(edits);
+    symbol_table_free();
 
     if (result) {
         return 0;
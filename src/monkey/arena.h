@@ -0,0 +1,33 @@
+#ifndef MONKEY_ARENA_H_
+#define MONKEY_ARENA_H_
+
+#include <stddef.h>
+
+typedef struct ArenaChunk ArenaChunk;
+struct ArenaChunk {
+    ArenaChunk* next;
+    size_t size;
+    size_t capacity;
+    max_align_t data[];
+};
+
+typedef struct Arena Arena;
+struct Arena {
+    ArenaChunk* chunk;
+};
+
+typedef struct ArenaMark ArenaMark;
+struct ArenaMark {
+    ArenaChunk* chunk;
+    size_t size;
+    ArenaChunk* next;
+};
+
+void arena_init(Arena*);
+void arena_free(Arena*);
+ArenaMark arena_mark(const Arena*);
+void arena_release(Arena*, ArenaMark);
+void arena_take(Arena*, Arena*);
+void* arena_allocate(Arena*, size_t);
+
+#endif // MONKEY_ARENA_H_
@@ -0,0 +1,98 @@
+#ifndef MONKEY_BYTECODE_H_
+#define MONKEY_BYTECODE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "monkey/arena.h"
+#include "monkey/hash.h"
+#include "monkey/object.h"
+#include "monkey/scope.h"
+#include "monkey/symbol.h"
+
+typedef enum Opcode Opcode;
+enum Opcode {
+    OPCODE_CONSTANT,
+    OPCODE_NULL,
+    OPCODE_TRUE,
+    OPCODE_FALSE,
+    OPCODE_POP,
+    OPCODE_GET_LOCAL,
+    OPCODE_SET_LOCAL,
+    OPCODE_UNSET_LOCAL,
+    OPCODE_GET_GLOBAL,
+    OPCODE_SET_GLOBAL,
+    OPCODE_GET_NAME,
+    OPCODE_NEGATIVE,
+    OPCODE_NOT,
+    OPCODE_EQUAL,
+    OPCODE_NOT_EQUAL,
+    OPCODE_GREATER,
+    OPCODE_GREATER_EQUAL,
+    OPCODE_LESS,
+    OPCODE_LESS_EQUAL,
+    OPCODE_ADD,
+    OPCODE_SUBTRACT,
+    OPCODE_MULTIPLY,
+    OPCODE_DIVIDE,
+    OPCODE_JUMP,
+    OPCODE_JUMP_FALSE,
+    OPCODE_JUMP_UNMARKED,
+    OPCODE_ARGUMENT,
+    OPCODE_CALL,
+    OPCODE_RETURN,
+    OPCODE_MARK_RETURN,
+};
+
+/*
+ * Instructions are a single opcode byte followed by zero or more operands.
+ * Constant, slot and jump operands are 32 bit big endian values. The argument
+ * count operand of a call instruction is a single byte, as are the index and
+ * count operands of the argument instruction that checks the function before
+ * each argument is evaluated.
+ */
+#define BYTECODE_OPERAND_SIZE 4
+#define BYTECODE_OPERAND_MAX 0xffffffff
+#define BYTECODE_ARGUMENTS_MAX 0xff
+
+typedef struct Code Code;
+struct Code {
+    uint8_t* bytes;
+    size_t size;
+    size_t capacity;
+    size_t parameters;
+    size_t locals;
+    const Symbol** names;
+};
+
+/*
+ * Integer and string constants are added once for each distinct value, keyed
+ * by their value in the constant index, so the number of constants does not
+ * grow with the number of literals.
+ */
+typedef struct Bytecode Bytecode;
+struct Bytecode {
+    Code* codes;
+    size_t codes_size;
+    size_t codes_capacity;
+    Object* constants;
+    size_t constants_size;
+    size_t constants_capacity;
+    HashTable constant_index;
+    Arena constant_keys;
+    const Scope* globals;
+};
+
+void code_init(Code*);
+void code_free(const Code*);
+bool code_emit(Code*, uint8_t);
+bool code_emit_operand(Code*, size_t);
+void code_patch_operand(Code*, size_t, size_t);
+size_t code_add_local(Code*, const Symbol*);
+void bytecode_init(Bytecode*);
+void bytecode_free(Bytecode*);
+size_t bytecode_add_code(Bytecode*);
+size_t bytecode_add_constant(Bytecode*, const Object*);
+
+#endif // MONKEY_BYTECODE_H_
@@ -0,0 +1,22 @@
+#ifndef MONKEY_CACHE_H_
+#define MONKEY_CACHE_H_
+
+#include <stdbool.h>
+
+#include "monkey/arena.h"
+#include "monkey/constant.h"
+#include "monkey/lexer.h"
+#include "monkey/statement.h"
+#include "monkey/string.h"
+
+/*
+ * The version of the cache format, which must be incremented whenever the
+ * encoding of the program or the meaning of the parsed tree changes.
+ */
+#define CACHE_VERSION 2
+
+void cache_path(String*, const char*);
+bool cache_load(const char*, const Lexer*, Arena*, ConstantPool*, StatementBlock*);
+void cache_store(const char*, const Lexer*, const StatementBlock*);
+
+#endif // MONKEY_CACHE_H_
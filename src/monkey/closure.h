@@ -0,0 +1,95 @@
+#ifndef MONKEY_CLOSURE_H_
+#define MONKEY_CLOSURE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "monkey/arena.h"
+#include "monkey/environment.h"
+#include "monkey/expression.h"
+#include "monkey/object.h"
+#include "monkey/scope.h"
+#include "monkey/statement.h"
+#include "monkey/symbol.h"
+
+/*
+ * A closure is a C function bound to the operands it needs, compiled once
+ * from an expression or statement. Running a closure calls its function
+ * directly, which runs the closures of its operands in turn, so that the type
+ * of a node is never dispatched on at runtime.
+ */
+typedef struct Closure Closure;
+typedef struct ClosureProgram ClosureProgram;
+typedef bool (*ClosureFunction)(const Closure*, Environment*, Object*);
+
+typedef struct ClosureBlock ClosureBlock;
+struct ClosureBlock {
+    Closure** statements;
+    size_t size;
+    const Scope* scope;
+};
+
+typedef struct ClosureVariable ClosureVariable;
+struct ClosureVariable {
+    const Symbol* symbol;
+    Binding binding;
+    Closure* value;
+};
+
+typedef struct ClosureOperation ClosureOperation;
+struct ClosureOperation {
+    Operation operation;
+    Closure* operand[2];
+};
+
+typedef struct ClosureConditional ClosureConditional;
+struct ClosureConditional {
+    Closure* condition;
+    ClosureBlock* consequence;
+    ClosureBlock* alternate;
+};
+
+typedef struct ClosureCall ClosureCall;
+struct ClosureCall {
+    Closure* function;
+    Closure** arguments;
+    size_t arguments_size;
+    const ClosureProgram* program;
+};
+
+struct Closure {
+    ClosureFunction function;
+    union {
+        int integer;
+        bool boolean;
+        ObjectString* string;
+        FunctionExpression* literal;
+        ClosureVariable variable;
+        ClosureOperation operation;
+        ClosureConditional conditional;
+        ClosureCall call;
+    };
+};
+
+/*
+ * The closures of a program live in its arena. The body of each function is
+ * compiled along with the rest of the program, and the function refers to it
+ * by its index among the bodies, in the same way that it refers to its
+ * bytecode.
+ */
+struct ClosureProgram {
+    Arena arena;
+    ClosureBlock** bodies;
+    size_t bodies_size;
+    size_t bodies_capacity;
+    ExpressionSpine spine;
+};
+
+void closure_program_init(ClosureProgram*);
+void closure_program_free(ClosureProgram*);
+Closure* closure_compile_expression(ClosureProgram*, Expression*);
+ClosureBlock* closure_compile_block(ClosureProgram*, StatementBlock*);
+bool closure_run_block(const ClosureBlock*, Environment*, Object*);
+void closure_execute_program(StatementBlock*);
+
+#endif // MONKEY_CLOSURE_H_
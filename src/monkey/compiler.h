@@ -0,0 +1,40 @@
+#ifndef MONKEY_COMPILER_H_
+#define MONKEY_COMPILER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "monkey/bytecode.h"
+#include "monkey/expression.h"
+#include "monkey/statement.h"
+
+/*
+ * A return statement leaves the blocks around it until its value is used by an
+ * expression, which is the function itself only when every block in between
+ * is the value of a statement. Returns that stop short of the function mark
+ * their value as returned and jump to the end of the conditional expression
+ * whose value they become, and the locals from the first slot of that
+ * expression on go out of scope.
+ */
+typedef struct Compiler Compiler;
+struct Compiler {
+    Bytecode* bytecode;
+    size_t code;
+    size_t* bases;
+    size_t size;
+    size_t capacity;
+    size_t* exits;
+    size_t exits_size;
+    size_t exits_capacity;
+    bool escaping;
+    size_t escape_locals;
+    ExpressionSpine spine;
+};
+
+void compiler_init(Compiler*, Bytecode*);
+void compiler_free(const Compiler*);
+bool compile_expression(Compiler*, Expression*);
+bool compile_statement(Compiler*, Statement*);
+bool compile_program(Bytecode*, StatementBlock*);
+
+#endif // MONKEY_COMPILER_H_
@@ -0,0 +1,26 @@
+#ifndef MONKEY_CONSTANT_H_
+#define MONKEY_CONSTANT_H_
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "monkey/hash.h"
+#include "monkey/object.h"
+
+/*
+ * The string literals of a program are interned in a pool of constants as the
+ * program is parsed. The pool holds a reference to each of its strings, so
+ * string objects evaluated from literals share them without copying, and
+ * their last reference is only released together with the pool.
+ */
+typedef struct ConstantPool ConstantPool;
+struct ConstantPool {
+    HashTable strings;
+    pthread_mutex_t mutex;
+};
+
+void constant_pool_init(ConstantPool*);
+void constant_pool_free(ConstantPool*);
+ObjectString* constant_pool_string(ConstantPool*, const char*, size_t);
+
+#endif // MONKEY_CONSTANT_H_
@@ -0,0 +1,51 @@
+#ifndef MONKEY_DOCUMENT_H_
+#define MONKEY_DOCUMENT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "monkey/arena.h"
+#include "monkey/constant.h"
+#include "monkey/error.h"
+#include "monkey/statement.h"
+
+/*
+ * A top level statement of a document, with the offset of its first token and
+ * the line on which it starts. Whether it ends with a semicolon tells whether
+ * its extent depends on the token that follows it.
+ */
+typedef struct DocumentStatement DocumentStatement;
+struct DocumentStatement {
+    Statement* statement;
+    size_t start;
+    size_t line;
+    ssize_t line_offset;
+    bool terminated;
+};
+
+/*
+ * A document holds a source that is edited, and the program parsed from it,
+ * which is kept up to date by parsing again only the top level statements
+ * touched by each edit.
+ */
+typedef struct Document Document;
+struct Document {
+    char* source;
+    size_t size;
+    size_t capacity;
+    Arena arena;
+    ConstantPool constants;
+    StatementBlock program;
+    DocumentStatement* statements;
+    size_t statements_size;
+    size_t statements_capacity;
+    size_t garbage;
+    Error error;
+};
+
+bool document_init(Document*, const char*, size_t);
+void document_free(Document*);
+bool document_edit(Document*, size_t, size_t, const char*, size_t);
+
+#endif // MONKEY_DOCUMENT_H_
@@ -3,19 +3,26 @@
 
 #include <stdbool.h>
 
-#include "monkey/hash.h"
 #include "monkey/object.h"
-#include "monkey/string.h"
+#include "monkey/scope.h"
+#include "monkey/stack.h"
 
 typedef struct Environment Environment;
 struct Environment {
-    HashTable table;
+    Object* objects;
+    size_t size;
+    const Scope* scope;
     Environment* next;
+    Environment* global;
+    Stack* stack;
 };
 
-void environment_init(Environment*, Environment*);
+void environment_init(Environment*, Environment*, const Scope*);
+void environment_init_global(Environment*, const Scope*, Stack*);
+void environment_extend(Environment*);
 void environment_free(Environment*);
-bool environment_insert(Environment*, const String*, const Object*);
-bool environment_retrieve(const Environment*, const String*, Object*);
+bool environment_insert(Environment*, const Binding*, const Object*);
+const Object* environment_lookup(const Environment*, const Binding*);
+bool environment_retrieve(const Environment*, const Binding*, Object*);
 
 #endif // MONKEY_ENVIRONMENT_H_
@@ -30,7 +30,6 @@ struct Error {
 };
 
 void error_init(Error*);
-void error_free(const Error*);
 void error_print(const Error*);
 
 #endif // MONKEY_ERROR_H_
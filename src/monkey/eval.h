@@ -5,8 +5,12 @@
 #include "monkey/object.h"
 #include "monkey/statement.h"
 
+bool evaluate_prefix_operation(Operation, Object*);
+bool evaluate_infix_operation(Operation, Object*, Object*);
 bool evaluate_expression(Environment*, Expression*, Object*);
 bool evaluate_statement(Environment*, Statement*, Object*);
+void evaluate_program_init(Environment*, const Scope*, Stack*);
+bool evaluate_program_statement(Environment*, Statement*);
 void evaluate_program(StatementBlock*);
 
 #endif // MONKEY_EVAL_H_
@@ -3,12 +3,21 @@
 
 #include <stdbool.h>
 
-#include "monkey/list.h"
+#include "monkey/arena.h"
+#include "monkey/lexer.h"
 #include "monkey/operation.h"
+#include "monkey/scope.h"
 #include "monkey/string.h"
+#include "monkey/symbol.h"
 
+typedef struct ObjectString ObjectString;
+typedef struct Parser Parser;
 typedef struct StatementBlock StatementBlock;
 
+/*
+ * The last types are specialized forms of identifiers, operations and calls,
+ * which the evaluator rewrites expressions into as it runs them.
+ */
 typedef enum ExpressionType ExpressionType;
 enum ExpressionType {
     EXPRESSION_NONE,
@@ -21,11 +30,16 @@ enum ExpressionType {
     EXPRESSION_CONDITIONAL,
     EXPRESSION_FUNCTION,
     EXPRESSION_CALL,
+    EXPRESSION_IDENTIFIER_INTEGER,
+    EXPRESSION_INFIX_INTEGER,
+    EXPRESSION_CALL_DIRECT,
 };
 
 typedef struct IdentifierExpression IdentifierExpression;
 struct IdentifierExpression {
-    String value;
+    const Symbol* symbol;
+    Binding binding;
+    unsigned char observed;
 };
 
 typedef struct BooleanExpression BooleanExpression;
@@ -38,23 +52,35 @@ struct IntegerExpression {
     int value;
 };
 
+/*
+ * String literals refer to the constant of the program holding their
+ * characters.
+ */
 typedef struct StringExpression StringExpression;
 struct StringExpression {
-    String value;
+    ObjectString* constant;
 };
 
 typedef struct Expression Expression;
 
+/*
+ * An operation is typed when type inference proved that its operands have the
+ * types it expects, integers or booleans, so that it is evaluated without
+ * checking them. Likewise for the condition of a typed conditional.
+ */
 typedef struct PrefixExpression PrefixExpression;
 struct PrefixExpression {
     Operation operation;
     Expression* operand;
+    bool typed;
 };
 
 typedef struct InfixExpression InfixExpression;
 struct InfixExpression {
     Operation operation;
     Expression* operand[2];
+    bool typed;
+    unsigned char observed;
 };
 
 typedef struct ConditionalExpression ConditionalExpression;
@@ -62,22 +88,45 @@ struct ConditionalExpression {
     Expression* condition;
     StatementBlock* consequence;
     StatementBlock* alternate;
+    bool typed;
 };
 
+/*
+ * The body of a function that is parsed lazily is only parsed when the function
+ * is first called. Until then the body is missing, and the parser and range of
+ * the source it is parsed from are kept instead.
+ */
 typedef struct FunctionExpression FunctionExpression;
 struct FunctionExpression {
-    List* parameters;
+    const Symbol** parameters;
+    size_t parameters_size;
     StatementBlock* body;
+    size_t code;
+    Parser* parser;
+    LexerRange range;
 };
 
+/*
+ * The target of a call is the function it called last, which a direct call
+ * assumes it calls again.
+ */
 typedef struct CallExpression CallExpression;
 struct CallExpression {
-    List* arguments;
+    Expression* arguments;
+    size_t arguments_size;
     Expression* function;
+    FunctionExpression* target;
+    unsigned char observed;
 };
 
+/*
+ * A shared expression is one of the canonical immutable subtrees of a
+ * HashCons, or a copy of one held in place, and the resources it refers to are
+ * owned by the HashCons rather than by the tree it appears in.
+ */
 struct Expression {
     ExpressionType type;
+    bool shared;
     union {
         IntegerExpression integer;
         BooleanExpression boolean;
@@ -91,19 +140,39 @@ struct Expression {
     };
 };
 
-Expression* expression_new();
-Expression* expression_move(const Expression*);
+/*
+ * Chains of left associative operators nest as deeply as they are long, so
+ * the passes over a tree follow them down their left operands onto a spine
+ * instead of recursing, then take the operations back off the spine in the
+ * order they are evaluated. A pass keeps one spine for all the chains it
+ * visits: each chain pushes above the size it found and pops back down to it.
+ */
+typedef struct ExpressionSpine ExpressionSpine;
+struct ExpressionSpine {
+    Expression** expressions;
+    size_t size;
+    size_t capacity;
+};
+
+Expression* expression_new(Arena*);
+Expression* expression_move(Arena*, const Expression*);
 bool expression_init_integer(Expression*, int);
 bool expression_init_bool(Expression*, bool);
-bool expression_init_string(Expression*, String*);
-bool expression_init_identifier(Expression*, String*);
-bool expression_init_prefix(Expression*, Operation);
-bool expression_init_infix(Expression*, Expression*, Operation);
-bool expression_init_conditional(Expression*);
+bool expression_init_string(Expression*, ObjectString*);
+bool expression_init_identifier(Expression*, const Symbol*);
+bool expression_init_prefix(Expression*, Arena*, Operation);
+bool expression_init_infix(Expression*, Arena*, Expression*, Operation);
+bool expression_init_conditional(Expression*, Arena*);
 bool expression_init_function(Expression*);
 bool expression_init_call(Expression*, Expression*);
 void expression_free(const Expression*);
-void expression_print_function_parameters(List*);
+void expression_free_block(const StatementBlock*);
+bool expression_contains_function(const Expression*);
+void expression_print_function_parameters(const FunctionExpression*);
 void expression_print(const Expression*, int, bool);
+void expression_spine_init(ExpressionSpine*);
+void expression_spine_free(const ExpressionSpine*);
+Expression* expression_spine_push(ExpressionSpine*, Expression*);
+Expression* expression_spine_pop(ExpressionSpine*, size_t);
 
 #endif // MONKEY_EXPRESSION_H_
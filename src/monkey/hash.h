@@ -1,21 +1,31 @@
 #ifndef MONKEY_HASH_H_
 #define MONKEY_HASH_H_
 
-typedef struct HashBucket HashBucket;
-struct HashBucket {
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct HashEntry HashEntry;
+struct HashEntry {
     char* key;
     void* value;
-    HashBucket* next;
+    uint64_t hash;
 };
 
 typedef struct HashTable HashTable;
 struct HashTable {
-    HashBucket* buckets[256];
+    HashEntry* entries;
+    size_t size;
+    size_t capacity;
 };
 
 void hash_init(HashTable*);
 void hash_free(const HashTable*, void (*)(void*));
-void hash_insert(HashTable*, char*, void*);
+uint64_t hash_key(const char*);
+uint64_t hash_key_span(const char*, size_t);
+void* hash_insert(HashTable*, char*, void*);
+void* hash_insert_hash(HashTable*, char*, uint64_t, void*);
 void* hash_retrieve(const HashTable*, const char*);
+void* hash_retrieve_hash(const HashTable*, const char*, uint64_t);
+void* hash_retrieve_span(const HashTable*, const char*, size_t, uint64_t);
 
 #endif // MONKEY_HASH_H_
@@ -0,0 +1,30 @@
+#ifndef MONKEY_HASHCONS_H_
+#define MONKEY_HASHCONS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "monkey/arena.h"
+#include "monkey/expression.h"
+#include "monkey/hash.h"
+#include "monkey/statement.h"
+
+/*
+ * A HashCons holds one canonical copy of each immutable subtree of the
+ * programs passed to it: literals, and operators applied to immutable
+ * subtrees. Identifiers are bound differently in different scopes, so no
+ * subtree containing one is ever shared. Structurally equal shared subtrees
+ * are the same node, so they can be compared by their address.
+ */
+typedef struct HashCons HashCons;
+struct HashCons {
+    Arena arena;
+    HashTable table;
+    ExpressionSpine spine;
+};
+
+void hashcons_init(HashCons*);
+void hashcons_free(HashCons*);
+void hashcons_program(HashCons*, StatementBlock*);
+
+#endif // MONKEY_HASHCONS_H_
@@ -0,0 +1,80 @@
+#ifndef MONKEY_INFER_H_
+#define MONKEY_INFER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "monkey/expression.h"
+#include "monkey/hash.h"
+#include "monkey/scope.h"
+#include "monkey/statement.h"
+#include "monkey/symbol.h"
+
+typedef enum InferType InferType;
+enum InferType {
+    INFER_UNKNOWN,
+    INFER_INTEGER,
+    INFER_BOOL,
+    INFER_STRING,
+    INFER_FUNCTION,
+};
+
+/*
+ * The type of the value held by a variable, as learned from a let statement or
+ * from an operation that only succeeds on values of that type. Local
+ * variables are identified by the level of their scope, counted from the body
+ * of the function they belong to. A fact whose name is cleared no longer holds.
+ * Each fact links to the one it shadows for the same variable, and to the
+ * previous fact still holding for the same name, by one more than its index.
+ */
+typedef struct InferFact InferFact;
+struct InferFact {
+    const Symbol* name;
+    BindingType binding;
+    size_t level;
+    size_t slot;
+    InferType type;
+    size_t shadowed;
+    size_t previous;
+};
+
+/*
+ * The latest fact about each variable of a scope, indexed by its slot, by one
+ * more than its index, or zero when there is none.
+ */
+typedef struct InferSlots InferSlots;
+struct InferSlots {
+    size_t* facts;
+    size_t capacity;
+};
+
+/*
+ * Facts are only learned within a function, from base on, since the variables
+ * of its caller are not known. They are found through the slots of the globals
+ * and of each level, and forgotten through the latest fact of each name. An
+ * expression is certain when it is evaluated whenever the program runs, unless
+ * an earlier one fails, and proven while none of those evaluated before it can.
+ */
+typedef struct Inferrer Inferrer;
+struct Inferrer {
+    InferFact* facts;
+    size_t facts_size;
+    size_t facts_capacity;
+    size_t base;
+    size_t level;
+    InferSlots globals;
+    InferSlots dynamics;
+    InferSlots* levels;
+    size_t levels_capacity;
+    HashTable names;
+    ExpressionSpine spine;
+    bool certain;
+    bool proven;
+    bool returns;
+};
+
+bool infer_expression(Inferrer*, Expression*, InferType*);
+bool infer_block(Inferrer*, StatementBlock*);
+bool infer_program(StatementBlock*);
+
+#endif // MONKEY_INFER_H_
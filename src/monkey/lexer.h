@@ -6,16 +6,50 @@
 
 #include "monkey/token.h"
 
+/*
+ * The lexer scans the whole source held in a single buffer, which is mapped
+ * from the file when possible and read into memory otherwise. Tokens refer to
+ * their lexemes in this buffer.
+ *
+ * A streaming lexer instead reads the source in pieces as it is scanned, and
+ * discards the source preceding the last token it returned. The number of
+ * characters discarded so far lets holders of earlier tokens find their
+ * lexemes again after the buffer has moved.
+ */
 typedef struct Lexer Lexer;
 struct Lexer {
-    FILE* file;
+    const char* source;
+    size_t size;
+    size_t offset;
     size_t line;
-    ssize_t position;
-    bool pushed;
-    char push;
+    ssize_t line_offset;
+    bool mapped;
+    int descriptor;
+    size_t capacity;
+    size_t start;
+    size_t mark;
+    size_t discarded;
+};
+
+/*
+ * A range of the source that starts at a statement boundary, together with the
+ * line on which it starts, so that it can be lexed independently.
+ */
+typedef struct LexerRange LexerRange;
+struct LexerRange {
+    size_t start;
+    size_t end;
+    size_t line;
+    ssize_t line_offset;
 };
 
 void lexer_init(Lexer*, FILE*);
+void lexer_init_stream(Lexer*, FILE*);
+void lexer_init_range(Lexer*, const Lexer*, const LexerRange*);
+void lexer_init_buffer(Lexer*, const char*, const LexerRange*);
+size_t lexer_split(const Lexer*, LexerRange*, size_t);
+void lexer_reset(Lexer*);
+void lexer_free(Lexer*);
 Token lexer_token_next(Lexer*);
 
 #endif // MONKEY_LEXER_H_
@@ -2,12 +2,14 @@
 #define MONKEY_OBJECT_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "monkey/expression.h"
 #include "monkey/string.h"
 
 typedef enum ObjectType ObjectType;
 enum ObjectType {
+    OBJECT_NONE,
     OBJECT_NULL,
     OBJECT_INTEGER,
     OBJECT_STRING,
@@ -16,12 +18,29 @@ enum ObjectType {
     OBJECT_INTERNAL,
 };
 
+/*
+ * String values are immutable once shared. Copies of a string object share the
+ * same buffer and only the last reference releases it. Long concatenations are
+ * represented as a rope referencing both operands, which is flattened into a
+ * single buffer the first time its characters are needed.
+ */
+#define OBJECT_STRING_ROPE_MIN 256
+
+typedef struct ObjectString ObjectString;
+struct ObjectString {
+    size_t references;
+    size_t length;
+    ObjectString* left;
+    ObjectString* right;
+    String value;
+};
+
 typedef struct Object Object;
 struct Object {
     ObjectType type;
     union {
         int integer;
-        String* string;
+        ObjectString* string;
         bool boolean;
         FunctionExpression* function;
         bool (*internal)(Object*);
@@ -31,6 +50,11 @@ struct Object {
 
 bool object_init_integer(Object*, int);
 bool object_init_string(Object*, String*);
+bool object_init_string_constant(Object*, ObjectString*);
+void object_string_release(ObjectString*);
+const String* object_string_value(const Object*);
+size_t object_string_length(const Object*);
+bool object_string_concatenate(Object*, const Object*);
 bool object_init_bool(Object*, bool);
 bool object_init_function(Object*, FunctionExpression*);
 bool object_init_internal(Object*, bool (*)(Object*));
@@ -0,0 +1,60 @@
+#ifndef MONKEY_OPTIMIZER_H_
+#define MONKEY_OPTIMIZER_H_
+
+#include <stddef.h>
+
+#include "monkey/arena.h"
+#include "monkey/constant.h"
+#include "monkey/expression.h"
+#include "monkey/hash.h"
+#include "monkey/statement.h"
+#include "monkey/symbol.h"
+
+/*
+ * A function that calls are inlined into, with the number of times each of
+ * its parameters is used by its body.
+ */
+typedef struct OptimizerInline OptimizerInline;
+struct OptimizerInline {
+    const FunctionExpression* function;
+    const Expression* body;
+    size_t* uses;
+};
+
+/*
+ * A name known to be bound where the expressions being optimized run, linked
+ * to the previous entry of the same name by one more than its index.
+ */
+typedef struct OptimizerBound OptimizerBound;
+struct OptimizerBound {
+    const Symbol* name;
+    size_t previous;
+};
+
+/*
+ * The optimizer allocates the expressions it creates from the arena of the
+ * program. It counts the bindings of every name of the program, and keeps the
+ * functions whose calls it inlines by the name they are bound to. The names
+ * known to be bound are the parameters of the innermost function and the
+ * variables let before in its blocks, from bound_base on, and the latest entry
+ * of each name is found through its index.
+ */
+typedef struct Optimizer Optimizer;
+struct Optimizer {
+    ConstantPool* constants;
+    Arena* arena;
+    HashTable bindings;
+    HashTable inlines;
+    OptimizerBound* bound;
+    size_t bound_size;
+    size_t bound_capacity;
+    size_t bound_base;
+    HashTable bound_index;
+    ExpressionSpine spine;
+};
+
+void optimize_expression(Optimizer*, Expression*);
+void optimize_block(Optimizer*, StatementBlock*);
+void optimize_program(StatementBlock*, ConstantPool*, Arena*);
+
+#endif // MONKEY_OPTIMIZER_H_
@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "monkey/arena.h"
+#include "monkey/constant.h"
 #include "monkey/error.h"
 #include "monkey/lexer.h"
 #include "monkey/statement.h"
@@ -11,17 +13,28 @@
 
 typedef struct Parser Parser;
 struct Parser {
+    Arena arena;
     Lexer lexer;
     Token token;
     Token token_next;
     Error error;
+    Parser* chunks;
+    size_t chunks_size;
+    bool lazy;
+    ConstantPool* constants;
 };
 
 void parser_init(Parser*, FILE*);
+void parser_init_stream(Parser*, FILE*);
+void parser_init_buffer(Parser*, const char*, const LexerRange*);
 void parser_free(Parser*);
+const Token* parser_peek(Parser*);
 bool parser_parse_expression(Parser*, Expression*, Precedence);
 bool parser_parse_expression_next(Parser*, Expression*, Precedence);
 bool parser_parse_statement(Parser*, Statement*);
+bool parser_parse_function_body(FunctionExpression*, Error*);
+bool parser_parse_program_next(Parser*, Statement*);
 bool parser_parse_program(Parser*, StatementBlock*);
+bool parser_parse_program_parallel(Parser*, StatementBlock*, size_t);
 
 #endif // MONKEY_PARSER_H_
@@ -0,0 +1,36 @@
+#ifndef MONKEY_RESOLVER_H_
+#define MONKEY_RESOLVER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "monkey/expression.h"
+#include "monkey/hash.h"
+#include "monkey/scope.h"
+#include "monkey/statement.h"
+#include "monkey/symbol.h"
+
+typedef struct Resolver Resolver;
+struct Resolver {
+    Scope* global;
+    HashTable index;
+    HashTable bound;
+    Scope** scopes;
+    size_t size;
+    size_t capacity;
+    size_t base;
+    ExpressionSpine spine;
+    bool function;
+    bool incremental;
+};
+
+void resolver_init(Resolver*, Scope*);
+void resolver_free(Resolver*);
+size_t resolver_global(Resolver*, const Symbol*);
+void resolver_bind_internal(Resolver*);
+bool resolve_expression(Resolver*, Expression*);
+bool resolve_statement(Resolver*, Statement*);
+bool resolve_function(Scope*, FunctionExpression*);
+bool resolve_program(StatementBlock*);
+
+#endif // MONKEY_RESOLVER_H_
@@ -0,0 +1,44 @@
+#ifndef MONKEY_SCOPE_H_
+#define MONKEY_SCOPE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "monkey/symbol.h"
+
+typedef enum BindingType BindingType;
+enum BindingType {
+    BINDING_NONE,
+    BINDING_LOCAL,
+    BINDING_GLOBAL,
+    BINDING_DYNAMIC,
+};
+
+/*
+ * The location of a variable as determined by the resolver. Local bindings are
+ * found by following the given number of enclosing environments and indexing
+ * the slot. Global bindings index the slot of the outermost environment.
+ * Dynamic bindings are searched by name in the chain of environments and fall
+ * back to the global slot.
+ */
+typedef struct Binding Binding;
+struct Binding {
+    BindingType type;
+    size_t depth;
+    size_t slot;
+};
+
+typedef struct Scope Scope;
+struct Scope {
+    const Symbol** names;
+    size_t size;
+    size_t capacity;
+};
+
+void binding_init(Binding*);
+void scope_init(Scope*);
+void scope_free(const Scope*);
+size_t scope_add(Scope*, const Symbol*);
+bool scope_find(const Scope*, const Symbol*, size_t*);
+
+#endif // MONKEY_SCOPE_H_
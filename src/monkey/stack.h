@@ -0,0 +1,27 @@
+#ifndef MONKEY_STACK_H_
+#define MONKEY_STACK_H_
+
+#include <stddef.h>
+
+#include "monkey/object.h"
+
+typedef struct StackChunk StackChunk;
+struct StackChunk {
+    StackChunk* previous;
+    StackChunk* next;
+    size_t size;
+    size_t capacity;
+    Object objects[];
+};
+
+typedef struct Stack Stack;
+struct Stack {
+    StackChunk* chunk;
+};
+
+void stack_init(Stack*);
+void stack_free(Stack*);
+Object* stack_push(Stack*, size_t);
+void stack_pop(Stack*, size_t);
+
+#endif // MONKEY_STACK_H_
@@ -1,8 +1,11 @@
 #ifndef MONKEY_STATEMENT_H_
 #define MONKEY_STATEMENT_H_
 
+#include "monkey/arena.h"
 #include "monkey/expression.h"
+#include "monkey/scope.h"
 #include "monkey/string.h"
+#include "monkey/symbol.h"
 
 typedef enum StatementType StatementType;
 enum StatementType {
@@ -15,7 +18,8 @@ enum StatementType {
 typedef struct Statement Statement;
 struct Statement {
     StatementType type;
-    String* identifier;
+    const Symbol* identifier;
+    Binding binding;
     Expression expression;
     Statement* next;
 };
@@ -24,16 +28,18 @@ typedef struct StatementBlock StatementBlock;
 struct StatementBlock {
     Statement* head;
     Statement* tail;
+    Scope scope;
 };
 
-bool statement_init_let(Statement*, String*);
+bool statement_init_let(Statement*, const Symbol*);
 bool statement_init_return(Statement*);
 bool statement_init_expression(Statement*);
 void statement_free(const Statement*);
 void statement_print(const Statement*, int);
 void statement_block_init(StatementBlock*);
 void statement_block_free(const StatementBlock*);
-void statement_block_extend(StatementBlock*, const Statement*);
+void statement_block_extend(StatementBlock*, Arena*, const Statement*);
+bool statement_block_contains_function(const StatementBlock*);
 void statement_block_print(const StatementBlock*, int);
 
 #endif // MONKEY_STATEMENT_H_
@@ -2,23 +2,49 @@
 #define MONKEY_STRING_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 
+#define STRING_INLINE_SIZE 23
+#define STRING_HEAP 0xff
+
+/*
+ * Strings whose capacity fits in STRING_INLINE_SIZE bytes, including the
+ * terminating null character, are stored in the struct itself, over the
+ * pointer and sizes of a heap string. The last byte of the struct holds the
+ * position of an inline string, or STRING_HEAP for a heap string, which keeps
+ * a string the size of three words. A new string is a heap string without
+ * characters. The characters must always be accessed through string_value,
+ * since the location of inline characters changes whenever the struct is
+ * copied.
+ */
 typedef struct String String;
 struct String {
-    size_t size;
-    size_t position;
-    char* value;
+    union {
+        struct {
+            char* value;
+            uint32_t position;
+            uint32_t size;
+        };
+        struct {
+            char buffer[STRING_INLINE_SIZE];
+            unsigned char state;
+        };
+    };
 };
 
 void string_init(String*);
 void string_free(const String*);
 void string_reset(String*);
+char* string_value(const String*);
+bool string_reserve(String*, size_t);
 bool string_append(String*, char);
+bool string_extend(String*, const char*, size_t);
 bool string_concatenate(String*, const String*);
 bool string_copy(String*, const String*);
 bool string_equal(const String*, const String*);
-int string_length(const String*);
+size_t string_length(const String*);
 void string_print(const String*);
 
 #endif // MONKEY_STRING_H_
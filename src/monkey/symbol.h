@@ -0,0 +1,18 @@
+#ifndef MONKEY_SYMBOL_H_
+#define MONKEY_SYMBOL_H_
+
+#include <stdint.h>
+
+#include "monkey/string.h"
+
+typedef struct Symbol Symbol;
+struct Symbol {
+    String name;
+    uint64_t hash;
+};
+
+const Symbol* symbol_intern(const char*);
+const Symbol* symbol_intern_span(const char*, size_t);
+void symbol_table_free(void);
+
+#endif // MONKEY_SYMBOL_H_
@@ -2,8 +2,7 @@
 #define MONKEY_TOKEN_H_
 
 #include <stddef.h>
-
-#include "monkey/string.h"
+#include <sys/types.h>
 
 typedef enum TokenType TokenType;
 enum TokenType {
@@ -48,19 +47,21 @@ enum TokenType {
     TOKEN_RIGHT_BRACKET,
 };
 
+/*
+ * The lexeme of a token refers to the characters of the token in the source
+ * buffer of the lexer and is only valid while the lexer is. It is not null
+ * terminated.
+ */
 typedef struct Token Token;
 struct Token {
     TokenType type;
     size_t line;
     ssize_t position;
-    String lexeme;
+    const char* lexeme;
+    size_t length;
 };
 
 void token_init(Token*, size_t, ssize_t);
-void token_free(const Token*);
-void token_reset(Token*);
-void token_append(Token*, char);
-void token_copy(Token*, const Token*);
 void token_print(const Token*);
 
 #endif // MONKEY_TOKEN_H_
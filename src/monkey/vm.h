@@ -0,0 +1,36 @@
+#ifndef MONKEY_VM_H_
+#define MONKEY_VM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "monkey/bytecode.h"
+#include "monkey/object.h"
+#include "monkey/statement.h"
+
+typedef struct Frame Frame;
+struct Frame {
+    const Code* code;
+    const uint8_t* ip;
+    size_t base;
+};
+
+typedef struct VirtualMachine VirtualMachine;
+struct VirtualMachine {
+    const Bytecode* bytecode;
+    Object* globals;
+    Object* stack;
+    size_t stack_size;
+    size_t stack_capacity;
+    Frame* frames;
+    size_t frames_size;
+    size_t frames_capacity;
+};
+
+void vm_init(VirtualMachine*, const Bytecode*);
+void vm_free(VirtualMachine*);
+bool vm_run(VirtualMachine*);
+void vm_execute_program(StatementBlock*);
+
+#endif // MONKEY_VM_H_
@@ -18,12 +18,155 @@ bool object_init_integer(Object* object, int value)
 bool object_init_string(Object* object, String* string)
 {
     object->type = OBJECT_STRING;
-    object->string = (String*)malloc(sizeof(String));
-    string_copy(object->string, string);
+    object->string = (ObjectString*)malloc(sizeof(ObjectString));
+    object->string->references = 1;
+    object->string->length = string_length(string);
+    object->string->left = NULL;
+    object->string->right = NULL;
+    string_copy(&object->string->value, string);
     object->returned = false;
     return true;
 }
 
+/*
+ * Take a reference to a string held elsewhere, such as a constant of the
+ * program, instead of copying its characters.
+ */
+bool object_init_string_constant(Object* object, ObjectString* string)
+{
+    object->type = OBJECT_STRING;
+    object->string = string;
+    object->string->references++;
+    object->returned = false;
+    return true;
+}
+
+/*
+ * Release a reference to a string. Ropes built by repeated concatenation can
+ * be arbitrarily deep, so their nodes are released without recursion.
+ */
+void object_string_release(ObjectString* string)
+{
+    if (--string->references > 0) {
+        return;
+    } else if (string->left == NULL) {
+        string_free(&string->value);
+        free(string);
+        return;
+    }
+
+    size_t size = 0;
+    size_t capacity = 16;
+    ObjectString** pending = (ObjectString**)malloc(capacity * sizeof(ObjectString*));
+    pending[size++] = string;
+    while (size > 0) {
+        string = pending[--size];
+        if (string->left == NULL) {
+            string_free(&string->value);
+            free(string);
+            continue;
+        }
+        if (size + 2 > capacity) {
+            capacity *= 2;
+            pending = (ObjectString**)realloc(pending, capacity * sizeof(ObjectString*));
+        }
+        if (--string->left->references == 0) {
+            pending[size++] = string->left;
+        }
+        if (--string->right->references == 0) {
+            pending[size++] = string->right;
+        }
+        free(string);
+    }
+    free(pending);
+}
+
+/*
+ * Copy the characters of a rope into a single buffer, visiting its leaves from
+ * left to right, and release the nodes it referenced.
+ */
+void object_string_flatten(ObjectString* string)
+{
+    String value;
+    string_init(&value);
+    string_reserve(&value, string->length + 1);
+
+    size_t size = 0;
+    size_t capacity = 16;
+    const ObjectString** pending = (const ObjectString**)malloc(capacity * sizeof(ObjectString*));
+    pending[size++] = string;
+    while (size > 0) {
+        const ObjectString* node = pending[--size];
+        if (node->left == NULL) {
+            string_concatenate(&value, &node->value);
+            continue;
+        }
+        if (size + 2 > capacity) {
+            capacity *= 2;
+            pending = (const ObjectString**)realloc(pending, capacity * sizeof(ObjectString*));
+        }
+        pending[size++] = node->right;
+        pending[size++] = node->left;
+    }
+    free(pending);
+
+    object_string_release(string->left);
+    object_string_release(string->right);
+    string->left = NULL;
+    string->right = NULL;
+    string->value = value;
+}
+
+const String* object_string_value(const Object* object)
+{
+    if (object->string->left != NULL) {
+        object_string_flatten(object->string);
+    }
+    return &object->string->value;
+}
+
+size_t object_string_length(const Object* object)
+{
+    return object->string->length;
+}
+
+/*
+ * Append a string to a string object. Short results are built directly, in
+ * place when the buffer is not shared. Longer results become a rope node so
+ * that repeated concatenation does not copy the accumulated characters again
+ * at each step.
+ */
+bool object_string_concatenate(Object* object, const Object* object_right)
+{
+    ObjectString* string = object->string;
+    ObjectString* string_right = object_right->string;
+    size_t length = string->length + string_right->length;
+
+    if (string_right->length == 0) {
+        return true;
+    } else if (length < OBJECT_STRING_ROPE_MIN && string->left == NULL && string_right->left == NULL) {
+        if (string->references > 1) {
+            // the copy keeps whether the value is being returned
+            bool returned = object->returned;
+            string->references--;
+            object_init_string(object, &string->value);
+            object->returned = returned;
+            string = object->string;
+        }
+        string->length = length;
+        return string_concatenate(&string->value, &string_right->value);
+    }
+
+    object->string = (ObjectString*)malloc(sizeof(ObjectString));
+    object->string->references = 1;
+    object->string->length = length;
+    object->string->left = string;
+    object->string->right = string_right;
+    string_init(&object->string->value);
+    string_right->references++;
+    return true;
+}
+
 bool object_init_bool(Object* object, bool value)
 {
     object->type = OBJECT_BOOL;
@@ -51,8 +194,7 @@ bool object_init_internal(Object* object, bool (*internal)(Object*))
 void object_free(Object* object)
 {
     if (object->type == OBJECT_STRING) {
-        string_free(object->string);
-        free(object->string);
+        object_string_release(object->string);
     }
     object->type = OBJECT_NULL;
     object->returned = false;
@@ -60,15 +202,18 @@ void object_free(Object* object)
 
 bool object_copy(Object* object, const Object* source)
 {
-    if (source->type == OBJECT_NULL) {
-        object->type = OBJECT_NULL;
+    if (source->type == OBJECT_NONE || source->type == OBJECT_NULL) {
+        object->type = source->type;
         object->returned = false;
     } else if (source->type == OBJECT_BOOL) {
         return object_init_bool(object, source->boolean);
     } else if (source->type == OBJECT_INTEGER) {
         return object_init_integer(object, source->integer);
     } else if (source->type == OBJECT_STRING) {
-        return object_init_string(object, source->string);
+        object->type = OBJECT_STRING;
+        object->string = source->string;
+        object->string->references++;
+        object->returned = false;
     } else if (source->type == OBJECT_FUNCTION) {
         return object_init_function(object, source->function);
     } else if (source->type == OBJECT_INTERNAL) {
@@ -84,6 +229,7 @@ bool object_equal(const Object* object, const Object* object_alt)
     }
 
     switch (object->type) {
+    case OBJECT_NONE:
     case OBJECT_NULL:
         return true;
     case OBJECT_BOOL:
@@ -91,7 +237,14 @@ bool object_equal(const Object* object, const Object* object_alt)
     case OBJECT_INTEGER:
         return object->integer == object_alt->integer;
     case OBJECT_STRING:
-        return string_equal(object->string, object_alt->string);
+        if (object->string == object_alt->string) {
+            return true;
+        } else if (object->string->length != object_alt->string->length) {
+            return false;
+        } else if (object->string->length == 0) {
+            return true;
+        }
+        return string_equal(object_string_value(object), object_string_value(object_alt));
     case OBJECT_FUNCTION:
         return object->function == object_alt->function;
     case OBJECT_INTERNAL:
@@ -104,13 +257,16 @@ bool object_equal(const Object* object, const Object* object_alt)
 void object_print_function(FunctionExpression* function)
 {
     printf("fn(");
-    expression_print_function_parameters(function->parameters);
+    expression_print_function_parameters(function);
     printf(") {...}");
 }
 
 void object_print(const Object* object)
 {
     switch (object->type) {
+    case OBJECT_NONE:
+        printf("NONE");
+        break;
     case OBJECT_NULL:
         printf("NULL");
         break;
@@ -121,7 +277,7 @@ void object_print(const Object* object)
         printf("%d", object->integer);
         break;
     case OBJECT_STRING:
-        string_print(object->string);
+        string_print(object_string_value(object));
         break;
     case OBJECT_FUNCTION:
         object_print_function(object->function);
@@ -0,0 +1,756 @@
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "monkey/arena.h"
+#include "monkey/constant.h"
+#include "monkey/expression.h"
+#include "monkey/hash.h"
+#include "monkey/object.h"
+#include "monkey/operation.h"
+#include "monkey/optimizer.h"
+#include "monkey/statement.h"
+#include "monkey/string.h"
+#include "monkey/symbol.h"
+
+/*
+ * The optimizer rewrites a parsed program before it is resolved. Operations
+ * on constants are folded, conditionals with a constant condition are replaced
+ * by the branch that runs, and statements following a return are dropped.
+ * Whatever would fail at runtime, such as an operation on mismatched types or
+ * a division by zero, is left in place so that it fails the same way.
+ */
+
+/*
+ * The largest number of nodes of the body of a function whose calls are
+ * inlined, and of an argument substituted for one of its parameters.
+ */
+#define OPTIMIZE_INLINE_SIZE_MAX 32
+
+bool optimize_constant(const Expression* expression)
+{
+    return expression->type == EXPRESSION_INTEGER || expression->type == EXPRESSION_BOOL || expression->type == EXPRESSION_STRING;
+}
+
+void optimize_prefix_expression(Expression* expression)
+{
+    const Expression* operand = expression->prefix.operand;
+    if (expression->prefix.operation == OPERATION_NEGATIVE && operand->type == EXPRESSION_INTEGER) {
+        // integers wrap around as they do when evaluated
+        expression_init_integer(expression, (int)(0u - (unsigned int)operand->integer.value));
+    } else if (expression->prefix.operation == OPERATION_NOT && operand->type == EXPRESSION_BOOL) {
+        expression_init_bool(expression, !operand->boolean.value);
+    }
+}
+
+bool optimize_constant_equal(const Expression* expression, const Expression* expression_alt)
+{
+    if (expression->type != expression_alt->type) {
+        return false;
+    } else if (expression->type == EXPRESSION_INTEGER) {
+        return expression->integer.value == expression_alt->integer.value;
+    } else if (expression->type == EXPRESSION_BOOL) {
+        return expression->boolean.value == expression_alt->boolean.value;
+    }
+    // the literals of a program are interned, so equal strings are the same constant
+    return expression->string.constant == expression_alt->string.constant;
+}
+
+void optimize_infix_integer(Expression* expression, int left, int right)
+{
+    unsigned int result;
+    switch (expression->infix.operation) {
+    case OPERATION_GREATER:
+        expression_init_bool(expression, left > right);
+        return;
+    case OPERATION_GREATER_EQUAL:
+        expression_init_bool(expression, left >= right);
+        return;
+    case OPERATION_LESS:
+        expression_init_bool(expression, left < right);
+        return;
+    case OPERATION_LESS_EQUAL:
+        expression_init_bool(expression, left <= right);
+        return;
+    case OPERATION_ADD:
+        result = (unsigned int)left + (unsigned int)right;
+        break;
+    case OPERATION_SUBTRACT:
+        result = (unsigned int)left - (unsigned int)right;
+        break;
+    case OPERATION_MULTIPLY:
+        result = (unsigned int)left * (unsigned int)right;
+        break;
+    case OPERATION_DIVIDE:
+        if (right == 0 || (left == INT_MIN && right == -1)) {
+            return;
+        }
+        result = (unsigned int)(left / right);
+        break;
+    default:
+        return;
+    }
+    expression_init_integer(expression, (int)result);
+}
+
+void optimize_infix_string(Optimizer* optimizer, Expression* expression)
+{
+    const ObjectString* left = expression->infix.operand[0]->string.constant;
+    const ObjectString* right = expression->infix.operand[1]->string.constant;
+
+    String value;
+    string_init(&value);
+    string_reserve(&value, left->length + right->length + 1);
+    string_concatenate(&value, &left->value);
+    string_concatenate(&value, &right->value);
+    expression_init_string(expression, constant_pool_string(optimizer->constants, string_value(&value), left->length + right->length));
+    string_free(&value);
+}
+
+void optimize_infix_fold(Optimizer* optimizer, Expression* expression)
+{
+    const Expression* left = expression->infix.operand[0];
+    const Expression* right = expression->infix.operand[1];
+    Operation operation = expression->infix.operation;
+    if (!optimize_constant(left) || !optimize_constant(right)) {
+        return;
+    } else if (operation == OPERATION_EQUAL || operation == OPERATION_NOT_EQUAL) {
+        expression_init_bool(expression, optimize_constant_equal(left, right) == (operation == OPERATION_EQUAL));
+    } else if (left->type == EXPRESSION_INTEGER && right->type == EXPRESSION_INTEGER) {
+        optimize_infix_integer(expression, left->integer.value, right->integer.value);
+    } else if (left->type == EXPRESSION_STRING && right->type == EXPRESSION_STRING && operation == OPERATION_ADD) {
+        optimize_infix_string(optimizer, expression);
+    }
+}
+
+/*
+ * The operations of a chain are folded innermost first, each once both of its
+ * operands are optimized.
+ */
+void optimize_infix_expression(Optimizer* optimizer, Expression* expression)
+{
+    size_t base = optimizer->spine.size;
+    optimize_expression(optimizer, expression_spine_push(&optimizer->spine, expression));
+    Expression* infix;
+    while ((infix = expression_spine_pop(&optimizer->spine, base)) != NULL) {
+        optimize_expression(optimizer, infix->infix.operand[1]);
+        optimize_infix_fold(optimizer, infix);
+    }
+}
+
+/*
+ * The branch of a conditional whose condition is a constant, or NULL when the
+ * condition is not constant.
+ */
+StatementBlock* optimize_conditional_branch(const ConditionalExpression* expression, StatementBlock** branch_dead)
+{
+    if (expression->condition->type != EXPRESSION_BOOL) {
+        return NULL;
+    } else if (expression->condition->boolean.value) {
+        *branch_dead = expression->alternate;
+        return expression->consequence;
+    }
+    *branch_dead = expression->consequence;
+    return expression->alternate;
+}
+
+/*
+ * Release a conditional whose statements taken from the branch that runs have
+ * been moved elsewhere.
+ */
+void optimize_conditional_release(StatementBlock* branch, StatementBlock* branch_dead)
+{
+    if (branch != NULL) {
+        scope_free(&branch->scope);
+    }
+    if (branch_dead != NULL) {
+        statement_block_free(branch_dead);
+    }
+}
+
+/*
+ * A conditional whose branch that runs is a single expression is replaced by
+ * that expression. Other branches can only be replaced by their statements as
+ * a whole, which is done by the block holding the conditional.
+ */
+void optimize_conditional_expression(Optimizer* optimizer, Expression* expression)
+{
+    ConditionalExpression* conditional = &expression->conditional;
+    optimize_expression(optimizer, conditional->condition);
+    optimize_block(optimizer, conditional->consequence);
+    if (conditional->alternate != NULL) {
+        optimize_block(optimizer, conditional->alternate);
+    }
+
+    StatementBlock* branch_dead = NULL;
+    StatementBlock* branch = optimize_conditional_branch(conditional, &branch_dead);
+    if (branch == NULL || branch->head == NULL || branch->head != branch->tail || branch->head->type != STATEMENT_EXPRESSION) {
+        return;
+    }
+    *expression = branch->head->expression;
+    optimize_conditional_release(branch, branch_dead);
+}
+
+/*
+ * Count the bindings of each name in the program, by let statements and by
+ * the parameters of functions, at any depth.
+ */
+void optimize_bind(Optimizer* optimizer, const Symbol* name)
+{
+    size_t* count = (size_t*)hash_retrieve_hash(&optimizer->bindings, string_value(&name->name), name->hash);
+    if (count == NULL) {
+        count = (size_t*)malloc(sizeof(size_t));
+        *count = 0;
+        hash_insert_hash(&optimizer->bindings, string_value(&name->name), name->hash, count);
+    }
+    (*count)++;
+}
+
+void optimize_count_block(Optimizer*, const StatementBlock*);
+
+void optimize_count_expression(Optimizer* optimizer, const Expression* expression)
+{
+    // chains of operators are followed down without recursion
+    while (expression->type == EXPRESSION_PREFIX || expression->type == EXPRESSION_INFIX) {
+        if (expression->type == EXPRESSION_PREFIX) {
+            expression = expression->prefix.operand;
+        } else {
+            optimize_count_expression(optimizer, expression->infix.operand[1]);
+            expression = expression->infix.operand[0];
+        }
+    }
+
+    switch (expression->type) {
+    case EXPRESSION_CONDITIONAL:
+        optimize_count_expression(optimizer, expression->conditional.condition);
+        optimize_count_block(optimizer, expression->conditional.consequence);
+        if (expression->conditional.alternate != NULL) {
+            optimize_count_block(optimizer, expression->conditional.alternate);
+        }
+        break;
+    case EXPRESSION_FUNCTION:
+        for (size_t i = 0; i < expression->function.parameters_size; ++i) {
+            optimize_bind(optimizer, expression->function.parameters[i]);
+        }
+        if (expression->function.body != NULL) {
+            optimize_count_block(optimizer, expression->function.body);
+        }
+        break;
+    case EXPRESSION_CALL:
+        optimize_count_expression(optimizer, expression->call.function);
+        for (size_t i = 0; i < expression->call.arguments_size; ++i) {
+            optimize_count_expression(optimizer, &expression->call.arguments[i]);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void optimize_count_block(Optimizer* optimizer, const StatementBlock* block)
+{
+    for (const Statement* statement = block->head; statement != NULL; statement = statement->next) {
+        if (statement->type == STATEMENT_LET) {
+            optimize_bind(optimizer, statement->identifier);
+        }
+        optimize_count_expression(optimizer, &statement->expression);
+    }
+}
+
+/*
+ * The lookup of a name known to be bound cannot fail, so an argument naming
+ * one can be substituted for a parameter however often the body uses it.
+ */
+void optimize_bound_push(Optimizer* optimizer, const Symbol* name)
+{
+    if (optimizer->bound_size >= optimizer->bound_capacity) {
+        optimizer->bound_capacity = optimizer->bound_capacity == 0 ? 16 : 2 * optimizer->bound_capacity;
+        optimizer->bound = (OptimizerBound*)realloc(optimizer->bound, optimizer->bound_capacity * sizeof(OptimizerBound));
+    }
+    OptimizerBound* bound = &optimizer->bound[optimizer->bound_size++];
+    bound->name = name;
+    bound->previous = (uintptr_t)hash_retrieve_hash(&optimizer->bound_index, string_value(&name->name), name->hash);
+    hash_insert_hash(&optimizer->bound_index, string_value(&name->name), name->hash, (void*)(uintptr_t)optimizer->bound_size);
+}
+
+void optimize_bound_restore(Optimizer* optimizer, size_t size)
+{
+    while (optimizer->bound_size > size) {
+        const OptimizerBound* bound = &optimizer->bound[--optimizer->bound_size];
+        hash_insert_hash(&optimizer->bound_index, string_value(&bound->name->name), bound->name->hash, (void*)(uintptr_t)bound->previous);
+    }
+}
+
+bool optimize_bound(const Optimizer* optimizer, const Symbol* name)
+{
+    return (uintptr_t)hash_retrieve_hash(&optimizer->bound_index, string_value(&name->name), name->hash) > optimizer->bound_base;
+}
+
+void optimize_bound_free(void* value)
+{
+    (void)value;
+}
+
+/*
+ * Check whether an expression can be inlined within the given number of
+ * nodes. It may only consist of literals, variables, operators and
+ * conditionals whose branches are plain expressions, so that it neither calls
+ * nor defines functions, binds variables nor returns.
+ */
+bool optimize_inline_fits(const Expression* expression, size_t* budget)
+{
+    if (*budget == 0) {
+        return false;
+    }
+    (*budget)--;
+
+    switch (expression->type) {
+    case EXPRESSION_INTEGER:
+    case EXPRESSION_BOOL:
+    case EXPRESSION_STRING:
+    case EXPRESSION_IDENTIFIER:
+        return true;
+    case EXPRESSION_PREFIX:
+        return optimize_inline_fits(expression->prefix.operand, budget);
+    case EXPRESSION_INFIX:
+        return optimize_inline_fits(expression->infix.operand[0], budget) && optimize_inline_fits(expression->infix.operand[1], budget);
+    case EXPRESSION_CONDITIONAL:
+        if (!optimize_inline_fits(expression->conditional.condition, budget)) {
+            return false;
+        }
+        for (int i = 0; i < 2; ++i) {
+            const StatementBlock* block = i == 0 ? expression->conditional.consequence : expression->conditional.alternate;
+            for (const Statement* statement = block == NULL ? NULL : block->head; statement != NULL; statement = statement->next) {
+                if (statement->type != STATEMENT_EXPRESSION || !optimize_inline_fits(&statement->expression, budget)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+size_t optimize_inline_parameter(const FunctionExpression* function, const Symbol* name)
+{
+    for (size_t i = 0; i < function->parameters_size; ++i) {
+        if (function->parameters[i] == name) {
+            return i;
+        }
+    }
+    return function->parameters_size;
+}
+
+void optimize_inline_uses(const Expression* expression, OptimizerInline* target)
+{
+    switch (expression->type) {
+    case EXPRESSION_IDENTIFIER: {
+        size_t i = optimize_inline_parameter(target->function, expression->identifier.symbol);
+        if (i < target->function->parameters_size) {
+            target->uses[i]++;
+        }
+        break;
+    }
+    case EXPRESSION_PREFIX:
+        optimize_inline_uses(expression->prefix.operand, target);
+        break;
+    case EXPRESSION_INFIX:
+        optimize_inline_uses(expression->infix.operand[0], target);
+        optimize_inline_uses(expression->infix.operand[1], target);
+        break;
+    case EXPRESSION_CONDITIONAL:
+        optimize_inline_uses(expression->conditional.condition, target);
+        for (int i = 0; i < 2; ++i) {
+            const StatementBlock* block = i == 0 ? expression->conditional.consequence : expression->conditional.alternate;
+            for (const Statement* statement = block == NULL ? NULL : block->head; statement != NULL; statement = statement->next) {
+                optimize_inline_uses(&statement->expression, target);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void optimize_inline_free(void* value)
+{
+    OptimizerInline* target = (OptimizerInline*)value;
+    free(target->uses);
+    free(target);
+}
+
+/*
+ * Calls are inlined into a function bound by a top level let statement, when
+ * nothing else in the program binds its name, since variables are dynamically
+ * scoped and any other binding could be the one a call refers to. Its calls
+ * are only inlined from the statements that follow, which run after it is
+ * bound. The body must be a single small expression, and since it makes no
+ * calls the function is not recursive and no function it would call could
+ * observe its parameters.
+ */
+void optimize_inline_register(Optimizer* optimizer, const Statement* statement)
+{
+    if (statement->type != STATEMENT_LET || statement->expression.type != EXPRESSION_FUNCTION) {
+        return;
+    }
+    const Symbol* name = statement->identifier;
+    const FunctionExpression* function = &statement->expression.function;
+    const size_t* count = (const size_t*)hash_retrieve_hash(&optimizer->bindings, string_value(&name->name), name->hash);
+    if (*count != 1 || function->body == NULL || function->body->head == NULL || function->body->head != function->body->tail) {
+        return;
+    }
+
+    const Statement* body = function->body->head;
+    size_t budget = OPTIMIZE_INLINE_SIZE_MAX;
+    if (body->type == STATEMENT_LET || !optimize_inline_fits(&body->expression, &budget)) {
+        return;
+    }
+    for (size_t i = 0; i < function->parameters_size; ++i) {
+        if (optimize_inline_parameter(function, function->parameters[i]) != i) {
+            return;
+        }
+    }
+
+    OptimizerInline* target = (OptimizerInline*)malloc(sizeof(OptimizerInline));
+    target->function = function;
+    target->body = &body->expression;
+    target->uses = (size_t*)calloc(function->parameters_size + 1, sizeof(size_t));
+    optimize_inline_uses(target->body, target);
+    hash_insert_hash(&optimizer->inlines, string_value(&name->name), name->hash, target);
+}
+
+StatementBlock* optimize_inline_copy_block(Optimizer*, const StatementBlock*, const OptimizerInline*, const Expression*);
+
+/*
+ * Copy the body of an inlined function into the place of a call, with a copy
+ * of the corresponding argument in place of each use of a parameter. The
+ * arguments themselves are copied without substitution.
+ */
+void optimize_inline_copy(Optimizer* optimizer, const Expression* source, Expression* expression, const OptimizerInline* target, const Expression* arguments)
+{
+    switch (source->type) {
+    case EXPRESSION_INTEGER:
+        expression_init_integer(expression, source->integer.value);
+        break;
+    case EXPRESSION_BOOL:
+        expression_init_bool(expression, source->boolean.value);
+        break;
+    case EXPRESSION_STRING:
+        expression_init_string(expression, source->string.constant);
+        break;
+    case EXPRESSION_IDENTIFIER: {
+        size_t i = target == NULL ? 0 : optimize_inline_parameter(target->function, source->identifier.symbol);
+        if (target != NULL && i < target->function->parameters_size) {
+            optimize_inline_copy(optimizer, &arguments[i], expression, NULL, NULL);
+        } else {
+            expression_init_identifier(expression, source->identifier.symbol);
+        }
+        break;
+    }
+    case EXPRESSION_PREFIX:
+        expression_init_prefix(expression, optimizer->arena, source->prefix.operation);
+        optimize_inline_copy(optimizer, source->prefix.operand, expression->prefix.operand, target, arguments);
+        break;
+    case EXPRESSION_INFIX:
+        expression_init_infix(expression, optimizer->arena, expression_new(optimizer->arena), source->infix.operation);
+        optimize_inline_copy(optimizer, source->infix.operand[0], expression->infix.operand[0], target, arguments);
+        optimize_inline_copy(optimizer, source->infix.operand[1], expression->infix.operand[1], target, arguments);
+        break;
+    case EXPRESSION_CONDITIONAL:
+        expression_init_conditional(expression, optimizer->arena);
+        optimize_inline_copy(optimizer, source->conditional.condition, expression->conditional.condition, target, arguments);
+        expression->conditional.consequence = optimize_inline_copy_block(optimizer, source->conditional.consequence, target, arguments);
+        if (source->conditional.alternate != NULL) {
+            expression->conditional.alternate = optimize_inline_copy_block(optimizer, source->conditional.alternate, target, arguments);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+StatementBlock* optimize_inline_copy_block(Optimizer* optimizer, const StatementBlock* source, const OptimizerInline* target, const Expression* arguments)
+{
+    StatementBlock* block = (StatementBlock*)arena_allocate(optimizer->arena, sizeof(StatementBlock));
+    statement_block_init(block);
+    for (const Statement* statement = source->head; statement != NULL; statement = statement->next) {
+        Statement copy;
+        statement_init_expression(&copy);
+        optimize_inline_copy(optimizer, &statement->expression, &copy.expression, target, arguments);
+        statement_block_extend(block, optimizer->arena, &copy);
+    }
+    return block;
+}
+
+/*
+ * Check whether an expression names one of the given number of first
+ * parameters of a function.
+ */
+bool optimize_inline_mentions(const Expression* expression, const FunctionExpression* function, size_t size)
+{
+    switch (expression->type) {
+    case EXPRESSION_IDENTIFIER:
+        return optimize_inline_parameter(function, expression->identifier.symbol) < size;
+    case EXPRESSION_PREFIX:
+        return optimize_inline_mentions(expression->prefix.operand, function, size);
+    case EXPRESSION_INFIX:
+        return optimize_inline_mentions(expression->infix.operand[0], function, size) || optimize_inline_mentions(expression->infix.operand[1], function, size);
+    case EXPRESSION_CONDITIONAL:
+        if (optimize_inline_mentions(expression->conditional.condition, function, size)) {
+            return true;
+        }
+        for (int i = 0; i < 2; ++i) {
+            const StatementBlock* block = i == 0 ? expression->conditional.consequence : expression->conditional.alternate;
+            for (const Statement* statement = block == NULL ? NULL : block->head; statement != NULL; statement = statement->next) {
+                if (optimize_inline_mentions(&statement->expression, function, size)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+/*
+ * Bind the arguments of a call to the parameters of the function it calls, in
+ * order, in a block that then evaluates its body. The block runs whenever the
+ * call would, so it is the branch of a conditional that always runs. The
+ * parameters are bound in the block before the later arguments are evaluated
+ * there, so no argument may name an earlier parameter.
+ */
+bool optimize_inline_bind(Optimizer* optimizer, const CallExpression* call, const OptimizerInline* target, Expression* inlined)
+{
+    const FunctionExpression* function = target->function;
+    for (size_t i = 1; i < call->arguments_size; ++i) {
+        if (optimize_inline_mentions(&call->arguments[i], function, i)) {
+            return false;
+        }
+    }
+
+    StatementBlock* block = (StatementBlock*)arena_allocate(optimizer->arena, sizeof(StatementBlock));
+    statement_block_init(block);
+    for (size_t i = 0; i < call->arguments_size; ++i) {
+        Statement let;
+        statement_init_let(&let, function->parameters[i]);
+        optimize_inline_copy(optimizer, &call->arguments[i], &let.expression, NULL, NULL);
+        statement_block_extend(block, optimizer->arena, &let);
+    }
+    Statement body;
+    statement_init_expression(&body);
+    optimize_inline_copy(optimizer, target->body, &body.expression, NULL, NULL);
+    statement_block_extend(block, optimizer->arena, &body);
+
+    expression_init_conditional(inlined, optimizer->arena);
+    expression_init_bool(inlined->conditional.condition, true);
+    inlined->conditional.consequence = block;
+    return true;
+}
+
+/*
+ * Replace a call by the body of the function it calls. Arguments make no
+ * calls, but they may still fail, and they must fail in order, as they do
+ * when evaluated before the call. So they are only substituted for the uses
+ * of their parameters when they are literals or variables known to be bound,
+ * which cannot fail, whether their uses are dropped, repeated or reordered.
+ * Otherwise they are bound to the parameters before the body runs.
+ */
+void optimize_call_inline(Optimizer* optimizer, Expression* expression)
+{
+    const CallExpression* call = &expression->call;
+    if (call->function->type != EXPRESSION_IDENTIFIER) {
+        return;
+    }
+    const Symbol* name = call->function->identifier.symbol;
+    const OptimizerInline* target = (const OptimizerInline*)hash_retrieve_hash(&optimizer->inlines, string_value(&name->name), name->hash);
+    if (target == NULL || call->arguments_size != target->function->parameters_size) {
+        return;
+    }
+    bool substituted = true;
+    for (size_t i = 0; i < call->arguments_size; ++i) {
+        const Expression* argument = &call->arguments[i];
+        size_t budget = OPTIMIZE_INLINE_SIZE_MAX;
+        if (!optimize_inline_fits(argument, &budget)) {
+            return;
+        } else if (!optimize_constant(argument) && (argument->type != EXPRESSION_IDENTIFIER || !optimize_bound(optimizer, argument->identifier.symbol))) {
+            substituted = false;
+        }
+    }
+
+    Expression inlined;
+    if (substituted) {
+        optimize_inline_copy(optimizer, target->body, &inlined, target, call->arguments);
+    } else if (!optimize_inline_bind(optimizer, call, target, &inlined)) {
+        return;
+    }
+    expression_free(expression);
+    *expression = inlined;
+    optimize_expression(optimizer, expression);
+}
+
+/*
+ * Only the parameters of a function are known to be bound in its body, since
+ * it may be called before any variable around it is bound.
+ */
+void optimize_function_expression(Optimizer* optimizer, FunctionExpression* function)
+{
+    size_t size = optimizer->bound_size;
+    size_t base = optimizer->bound_base;
+    optimizer->bound_base = size;
+    for (size_t i = 0; i < function->parameters_size; ++i) {
+        optimize_bound_push(optimizer, function->parameters[i]);
+    }
+    optimize_block(optimizer, function->body);
+    optimize_bound_restore(optimizer, size);
+    optimizer->bound_base = base;
+}
+
+void optimize_expression(Optimizer* optimizer, Expression* expression)
+{
+    switch (expression->type) {
+    case EXPRESSION_PREFIX:
+        optimize_expression(optimizer, expression->prefix.operand);
+        optimize_prefix_expression(expression);
+        break;
+    case EXPRESSION_INFIX:
+        optimize_infix_expression(optimizer, expression);
+        break;
+    case EXPRESSION_CONDITIONAL:
+        optimize_conditional_expression(optimizer, expression);
+        break;
+    case EXPRESSION_FUNCTION:
+        if (expression->function.body != NULL) {
+            optimize_function_expression(optimizer, &expression->function);
+        }
+        break;
+    case EXPRESSION_CALL:
+        optimize_expression(optimizer, expression->call.function);
+        for (size_t i = 0; i < expression->call.arguments_size; ++i) {
+            optimize_expression(optimizer, &expression->call.arguments[i]);
+        }
+        optimize_call_inline(optimizer, expression);
+        break;
+    default:
+        break;
+    }
+}
+
+bool optimize_block_declares(const StatementBlock* block)
+{
+    for (const Statement* statement = block->head; statement != NULL; statement = statement->next) {
+        if (statement->type == STATEMENT_LET) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * A conditional statement whose branch that runs declares no variables is
+ * replaced by the statements of that branch, which then run in the enclosing
+ * block. A branch that is missing or empty only produces a value when it is
+ * the last statement of the block, and the statement is dropped otherwise.
+ * Returns the statement taking the place of the conditional.
+ */
+Statement* optimize_block_branch(Statement* statement, bool* replaced)
+{
+    *replaced = false;
+    if (statement->type != STATEMENT_EXPRESSION || statement->expression.type != EXPRESSION_CONDITIONAL) {
+        return statement;
+    }
+
+    ConditionalExpression* conditional = &statement->expression.conditional;
+    StatementBlock* branch_dead = NULL;
+    StatementBlock* branch = optimize_conditional_branch(conditional, &branch_dead);
+    if (conditional->condition->type != EXPRESSION_BOOL || (branch != NULL && optimize_block_declares(branch))) {
+        return statement;
+    } else if (branch == NULL || branch->head == NULL) {
+        if (statement->next == NULL) {
+            return statement;
+        }
+        *replaced = true;
+        Statement* next = statement->next;
+        statement_free(statement);
+        return next;
+    }
+
+    *replaced = true;
+    branch->tail->next = statement->next;
+    Statement* head = branch->head;
+    optimize_conditional_release(branch, branch_dead);
+    return head;
+}
+
+void optimize_block_statements(StatementBlock* block)
+{
+    // the statements taking the place of a conditional are already optimized
+    Statement** link = &block->head;
+    Statement* tail = NULL;
+    while (*link != NULL) {
+        bool replaced;
+        *link = optimize_block_branch(*link, &replaced);
+        if (replaced) {
+            continue;
+        }
+
+        Statement* statement = *link;
+        tail = statement;
+        link = &statement->next;
+        if (statement->type == STATEMENT_RETURN) {
+            // statements following a return are never reached
+            for (Statement* unreachable = statement->next; unreachable != NULL; unreachable = unreachable->next) {
+                statement_free(unreachable);
+            }
+            statement->next = NULL;
+        }
+    }
+    block->tail = tail;
+}
+
+void optimize_block(Optimizer* optimizer, StatementBlock* block)
+{
+    size_t size = optimizer->bound_size;
+    for (Statement* statement = block->head; statement != NULL; statement = statement->next) {
+        optimize_expression(optimizer, &statement->expression);
+        if (statement->type == STATEMENT_LET) {
+            optimize_bound_push(optimizer, statement->identifier);
+        }
+    }
+    optimize_bound_restore(optimizer, size);
+    optimize_block_statements(block);
+}
+
+void optimize_program(StatementBlock* block, ConstantPool* constants, Arena* arena)
+{
+    Optimizer optimizer;
+    optimizer.constants = constants;
+    optimizer.arena = arena;
+    hash_init(&optimizer.bindings);
+    hash_init(&optimizer.inlines);
+    optimizer.bound = NULL;
+    optimizer.bound_size = 0;
+    optimizer.bound_capacity = 0;
+    optimizer.bound_base = 0;
+    hash_init(&optimizer.bound_index);
+    expression_spine_init(&optimizer.spine);
+
+    optimize_count_block(&optimizer, block);
+    for (Statement* statement = block->head; statement != NULL; statement = statement->next) {
+        optimize_expression(&optimizer, &statement->expression);
+        optimize_inline_register(&optimizer, statement);
+        if (statement->type == STATEMENT_LET) {
+            optimize_bound_push(&optimizer, statement->identifier);
+        }
+    }
+    optimize_block_statements(block);
+
+    hash_free(&optimizer.bindings, free);
+    hash_free(&optimizer.inlines, optimize_inline_free);
+    free(optimizer.bound);
+    hash_free(&optimizer.bound_index, optimize_bound_free);
+    expression_spine_free(&optimizer.spine);
+}
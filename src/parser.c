@@ -1,46 +1,143 @@
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "monkey/arena.h"
+#include "monkey/constant.h"
 #include "monkey/error.h"
 #include "monkey/expression.h"
-#include "monkey/list.h"
 #include "monkey/parser.h"
 #include "monkey/statement.h"
 #include "monkey/string.h"
+#include "monkey/symbol.h"
 #include "monkey/token.h"
 
+/*
+ * The number of chunks the source is split into for each thread parsing it in
+ * parallel, so that threads that finish early can pick up remaining chunks.
+ */
+#define PARSER_CHUNKS_PER_JOB 4
+
 void parser_init(Parser* parser, FILE* file)
 {
+    arena_init(&parser->arena);
     lexer_init(&parser->lexer, file);
-    token_init(&parser->token, parser->lexer.line, parser->lexer.position);
-    parser->token_next = lexer_token_next(&parser->lexer);
+    token_init(&parser->token, 0, 0);
+    token_init(&parser->token_next, 0, 0);
+    error_init(&parser->error);
+    parser->chunks = NULL;
+    parser->chunks_size = 0;
+    parser->lazy = false;
+    parser->constants = (ConstantPool*)malloc(sizeof(ConstantPool));
+    constant_pool_init(parser->constants);
+}
+
+/*
+ * Set up a parser that reads its source from the file as it parses, so that
+ * the statements of a program can be handled before the rest of it is read.
+ */
+void parser_init_stream(Parser* parser, FILE* file)
+{
+    arena_init(&parser->arena);
+    lexer_init_stream(&parser->lexer, file);
+    token_init(&parser->token, 0, 0);
+    token_init(&parser->token_next, 0, 0);
+    error_init(&parser->error);
+    parser->chunks = NULL;
+    parser->chunks_size = 0;
+    parser->lazy = false;
+    parser->constants = (ConstantPool*)malloc(sizeof(ConstantPool));
+    constant_pool_init(parser->constants);
+}
+
+/*
+ * Set up a parser for a range of the source of another parser. The tree it
+ * produces is allocated from its own arena, which is released when the parser
+ * of the whole source is freed, and its literals are interned in the constants
+ * of the whole source.
+ */
+void parser_init_range(Parser* parser, const Parser* source, const LexerRange* range)
+{
+    parser_init_buffer(parser, source->lexer.source, range);
+    parser->constants = source->constants;
+}
+
+/*
+ * Set up a parser for a range of a source held in a buffer owned by the
+ * caller. Like the parsers of ranges of another parser, it is not freed, the
+ * tree it produces must be taken from its arena, and the caller provides the
+ * constants its literals are interned in.
+ */
+void parser_init_buffer(Parser* parser, const char* source, const LexerRange* range)
+{
+    arena_init(&parser->arena);
+    lexer_init_buffer(&parser->lexer, source, range);
+    token_init(&parser->token, 0, 0);
+    token_init(&parser->token_next, 0, 0);
     error_init(&parser->error);
+    parser->chunks = NULL;
+    parser->chunks_size = 0;
+    parser->lazy = false;
+    parser->constants = NULL;
 }
 
 void parser_free(Parser* parser)
 {
-    token_free(&parser->token);
-    error_free(&parser->error);
+    for (size_t i = 0; i < parser->chunks_size; ++i) {
+        arena_free(&parser->chunks[i].arena);
+    }
+    free(parser->chunks);
+    lexer_free(&parser->lexer);
+    arena_free(&parser->arena);
+    constant_pool_free(parser->constants);
+    free(parser->constants);
 }
 
-bool parser_next(Parser* parser)
+/*
+ * The next token is only read when the parser needs to look at it, so that a
+ * statement is complete as soon as its last token has been read. Reading it may
+ * move the source of a streaming lexer, in which case the lexeme of the current
+ * token is located again.
+ */
+const Token* parser_peek(Parser* parser)
 {
-    token_free(&parser->token);
-    parser->token = parser->token_next;
+    if (parser->token_next.type != TOKEN_NONE) {
+        return &parser->token_next;
+    }
+
+    const char* source = parser->lexer.source;
+    size_t discarded = parser->lexer.discarded;
     parser->token_next = lexer_token_next(&parser->lexer);
+    if (parser->token.type != TOKEN_NONE && parser->lexer.source != source) {
+        size_t offset = (size_t)(parser->token.lexeme - source) + discarded - parser->lexer.discarded;
+        parser->token.lexeme = parser->lexer.source + offset;
+    }
+    return &parser->token_next;
+}
+
+bool parser_next(Parser* parser)
+{
+    if (parser->token_next.type == TOKEN_NONE) {
+        parser->token = lexer_token_next(&parser->lexer);
+    } else {
+        parser->token = parser->token_next;
+        token_init(&parser->token_next, 0, 0);
+    }
     return parser->token.type != TOKEN_END && parser->token.type != TOKEN_ILLEGAL;
 }
 
 void parser_error(Parser* parser, ErrorType type)
 {
     parser->error.type = type;
-    token_copy(&parser->error.token, &parser->token);
+    parser->error.token = parser->token;
 }
 
 bool parser_next_if(Parser* parser, TokenType token_type)
 {
-    if (parser->token_next.type == token_type) {
+    if (parser_peek(parser)->type == token_type) {
         parser_next(parser);
         return true;
     }
@@ -59,7 +156,7 @@ bool parser_next_expect(Parser* parser, TokenType token_type, ErrorType error_ty
 
 bool parser_parse_prefix_expression(Parser* parser, Expression* expression, Operation operation)
 {
-    expression_init_prefix(expression, operation);
+    expression_init_prefix(expression, &parser->arena, operation);
 
     return parser_parse_expression_next(parser, expression->prefix.operand, PRECEDENCE_PREFIX);
 }
@@ -88,7 +185,7 @@ bool parser_parse_block_expression(Parser* parser, StatementBlock* block)
             statement_free(&statement);
             return false;
         }
-        statement_block_extend(block, &statement);
+        statement_block_extend(block, &parser->arena, &statement);
         parser_next(parser);
     }
 
@@ -99,7 +196,7 @@ bool parser_parse_conditional_expression(Parser* parser, Expression* expression)
 {
     if (!parser_next_expect(parser, TOKEN_LEFT_PAREN, ERROR_EXPRESSION_IF_EXPECTED_LEFT_PAREN)) {
         return false;
-    } else if (!expression_init_conditional(expression)) {
+    } else if (!expression_init_conditional(expression, &parser->arena)) {
         return false;
     } else if (!parser_parse_expression_next(parser, expression->conditional.condition, PRECEDENCE_LOWEST)) {
         return false;
@@ -107,7 +204,7 @@ bool parser_parse_conditional_expression(Parser* parser, Expression* expression)
         return false;
     }
 
-    expression->conditional.consequence = (StatementBlock*)malloc(sizeof(StatementBlock));
+    expression->conditional.consequence = (StatementBlock*)arena_allocate(&parser->arena, sizeof(StatementBlock));
     statement_block_init(expression->conditional.consequence);
 
     if (!parser_parse_block_expression(parser, expression->conditional.consequence)) {
@@ -116,123 +213,353 @@ bool parser_parse_conditional_expression(Parser* parser, Expression* expression)
         return true;
     }
 
-    expression->conditional.alternate = (StatementBlock*)malloc(sizeof(StatementBlock));
+    expression->conditional.alternate = (StatementBlock*)arena_allocate(&parser->arena, sizeof(StatementBlock));
     statement_block_init(expression->conditional.alternate);
 
     return parser_parse_block_expression(parser, expression->conditional.alternate);
 }
 
-bool parser_parse_function_expression_parameter(Parser* parser, List** parameters)
+/*
+ * Parameters and arguments are collected in a temporary array, since their
+ * number is only known at the closing parenthesis, and then copied into a
+ * contiguous array in the arena.
+ */
+void* parser_parse_list_item(void** items, size_t* size, size_t* capacity, size_t item_size)
+{
+    if (*size >= *capacity) {
+        *capacity = *capacity == 0 ? 4 : 2 * *capacity;
+        *items = realloc(*items, *capacity * item_size);
+    }
+    return (char*)*items + (*size)++ * item_size;
+}
+
+void* parser_parse_list_finish(Parser* parser, void* items, size_t size, size_t item_size)
+{
+    void* list = NULL;
+    if (size > 0) {
+        list = arena_allocate(&parser->arena, size * item_size);
+        memcpy(list, items, size * item_size);
+    }
+    free(items);
+    return list;
+}
+
+bool parser_parse_function_expression_parameters(Parser* parser, FunctionExpression* expression)
+{
+    //  zero parameters
+    if (parser_next_if(parser, TOKEN_RIGHT_PAREN)) {
+        return true;
+    }
+
+    const Symbol** parameters = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+    do {
+        if (size > 0 && !parser_next_expect(parser, TOKEN_COMMA, ERROR_EXPRESSION_FUNCTION_EXPECTED_COMMA)) {
+            free(parameters);
+            return false;
+        } else if (!parser_next_expect(parser, TOKEN_IDENTIFIER, ERROR_EXPRESSION_FUNCTION_EXPECTED_IDENTIFIER)) {
+            free(parameters);
+            return false;
+        }
+        const Symbol** parameter = (const Symbol**)parser_parse_list_item((void**)&parameters, &size, &capacity, sizeof(Symbol*));
+        *parameter = symbol_intern_span(parser->token.lexeme, parser->token.length);
+    } while (!parser_next_if(parser, TOKEN_RIGHT_PAREN));
+
+    expression->parameters = (const Symbol**)parser_parse_list_finish(parser, parameters, size, sizeof(Symbol*));
+    expression->parameters_size = size;
+    return true;
+}
+
+Operation parser_parse_infix_operation(Parser*);
+bool parser_check_expression(Parser*, Precedence);
+bool parser_check_statements(Parser*);
+
+/*
+ * The body of a function that is parsed lazily is checked as it is skipped.
+ * The checks follow the grammar of the parser and report the same errors, so
+ * that a program is rejected whether or not its functions are called, but
+ * they build no tree and intern nothing.
+ */
+bool parser_check_expression_next(Parser* parser, Precedence precedence)
+{
+    parser_next(parser);
+    return parser_check_expression(parser, precedence);
+}
+
+bool parser_check_block(Parser* parser)
+{
+    if (!parser_next_expect(parser, TOKEN_LEFT_BRACE, ERROR_EXPRESSION_BLOCK_EXPECTED_LEFT_BRACE)) {
+        return false;
+    }
+    return parser_check_statements(parser);
+}
+
+bool parser_check_conditional(Parser* parser)
 {
-    String name;
-    if (!parser_next_expect(parser, TOKEN_IDENTIFIER, ERROR_EXPRESSION_FUNCTION_EXPECTED_IDENTIFIER)) {
+    if (!parser_next_expect(parser, TOKEN_LEFT_PAREN, ERROR_EXPRESSION_IF_EXPECTED_LEFT_PAREN)) {
         return false;
-    } else if (!string_copy(&name, &parser->token.lexeme)) {
+    } else if (!parser_check_expression_next(parser, PRECEDENCE_LOWEST)) {
         return false;
-    } else if (!list_append(parameters, &name, sizeof(String))) {
-        string_free(&name);
+    } else if (!parser_next_expect(parser, TOKEN_RIGHT_PAREN, ERROR_EXPRESSION_IF_EXPECTED_RIGHT_PAREN)) {
         return false;
+    } else if (!parser_check_block(parser)) {
+        return false;
+    } else if (!parser_next_if(parser, TOKEN_ELSE)) {
+        return true;
     }
-    return true;
+    return parser_check_block(parser);
 }
 
-bool parser_parse_function_expression_parameters(Parser* parser, List** parameters)
+bool parser_check_function(Parser* parser)
+{
+    if (!parser_next_expect(parser, TOKEN_LEFT_PAREN, ERROR_EXPRESSION_FUNCTION_EXPECTED_LEFT_PAREN)) {
+        return false;
+    } else if (!parser_next_if(parser, TOKEN_RIGHT_PAREN)) {
+        bool first = true;
+        do {
+            if (!first && !parser_next_expect(parser, TOKEN_COMMA, ERROR_EXPRESSION_FUNCTION_EXPECTED_COMMA)) {
+                return false;
+            } else if (!parser_next_expect(parser, TOKEN_IDENTIFIER, ERROR_EXPRESSION_FUNCTION_EXPECTED_IDENTIFIER)) {
+                return false;
+            }
+            first = false;
+        } while (!parser_next_if(parser, TOKEN_RIGHT_PAREN));
+    }
+    return parser_check_block(parser);
+}
+
+bool parser_check_call_arguments(Parser* parser)
 {
-    //  zero parameters
     if (parser_next_if(parser, TOKEN_RIGHT_PAREN)) {
         return true;
     }
 
-    // first parameter
-    if (!parser_parse_function_expression_parameter(parser, parameters)) {
+    bool first = true;
+    do {
+        if (!first && !parser_next_expect(parser, TOKEN_COMMA, ERROR_EXPRESSION_CALL_EXPECTED_COMMA)) {
+            return false;
+        } else if (!parser_check_expression_next(parser, PRECEDENCE_LOWEST)) {
+            return false;
+        }
+        first = false;
+    } while (!parser_next_if(parser, TOKEN_RIGHT_PAREN));
+    return true;
+}
+
+bool parser_check_expression_left(Parser* parser)
+{
+    switch (parser->token.type) {
+    case TOKEN_IDENTIFIER:
+    case TOKEN_INTEGER:
+    case TOKEN_STRING:
+    case TOKEN_TRUE:
+    case TOKEN_FALSE:
+        return true;
+    case TOKEN_MINUS:
+    case TOKEN_NOT:
+        return parser_check_expression_next(parser, PRECEDENCE_PREFIX);
+    case TOKEN_LEFT_PAREN:
+        if (!parser_check_expression_next(parser, PRECEDENCE_LOWEST)) {
+            return false;
+        } else if (!parser_next_if(parser, TOKEN_RIGHT_PAREN)) {
+            parser_error(parser, ERROR_EXPRESSION_GROUP_EXPECTED_PAREN);
+            return false;
+        }
+        return true;
+    case TOKEN_IF:
+        return parser_check_conditional(parser);
+    case TOKEN_FUNCTION:
+        return parser_check_function(parser);
+    default:
+        parser_error(parser, ERROR_TOKEN_UNEXPECTED);
         return false;
     }
+}
 
-    // remaining parameters
-    List* parameter = *parameters;
-    while (!parser_next_if(parser, TOKEN_RIGHT_PAREN)) {
-        if (!parser_next_expect(parser, TOKEN_COMMA, ERROR_EXPRESSION_FUNCTION_EXPECTED_COMMA)) {
+bool parser_check_expression(Parser* parser, Precedence precedence_min)
+{
+    if (!parser_check_expression_left(parser)) {
+        return false;
+    }
+    while (true) {
+        if (parser_next_if(parser, TOKEN_LEFT_PAREN) && !parser_check_call_arguments(parser)) {
             return false;
-        } else if (!parser_parse_function_expression_parameter(parser, &parameter->next)) {
+        }
+
+        Operation operation = parser_parse_infix_operation(parser);
+        if (operation == OPERATION_NONE || operation_precedence(operation) <= precedence_min) {
+            return true;
+        }
+        parser_next(parser);
+        if (!parser_check_expression_next(parser, operation_precedence(operation))) {
             return false;
         }
-        parameter = parameter->next;
     }
+}
 
+bool parser_check_statement(Parser* parser)
+{
+    bool result;
+    if (parser->token.type == TOKEN_LET) {
+        result = parser_next_expect(parser, TOKEN_IDENTIFIER, ERROR_LET_TOKEN_IDENTIFIER)
+            && parser_next_expect(parser, TOKEN_ASSIGN, ERROR_LET_TOKEN_ASSIGN)
+            && parser_check_expression_next(parser, PRECEDENCE_LOWEST);
+    } else if (parser->token.type == TOKEN_RETURN) {
+        result = parser_check_expression_next(parser, PRECEDENCE_LOWEST);
+    } else {
+        result = parser_check_expression(parser, PRECEDENCE_LOWEST);
+    }
+    if (result) {
+        parser_next_if(parser, TOKEN_SEMICOLON);
+    }
+    return result;
+}
+
+/*
+ * Check the statements of a block up to its closing brace, after its opening
+ * brace has been read.
+ */
+bool parser_check_statements(Parser* parser)
+{
+    parser_next(parser);
+    while (parser->token.type != TOKEN_RIGHT_BRACE) {
+        if (!parser_check_statement(parser)) {
+            return false;
+        }
+        parser_next(parser);
+    }
     return true;
 }
 
-bool parser_parse_function_expression(Parser* parser, Expression* expression)
+/*
+ * Skip the body of a function that is parsed lazily, checking its syntax, and
+ * record where it is in the source.
+ */
+bool parser_skip_function_body(Parser* parser, FunctionExpression* expression)
 {
-    if (!parser_next_expect(parser, TOKEN_LEFT_PAREN, ERROR_EXPRESSION_FUNCTION_EXPECTED_LEFT_PAREN)) {
-        return false;
-    } else if (!expression_init_function(expression)) {
+    if (!parser_next_expect(parser, TOKEN_LEFT_BRACE, ERROR_EXPRESSION_BLOCK_EXPECTED_LEFT_BRACE)) {
         return false;
-    } else if (!parser_parse_function_expression_parameters(parser, &expression->function.parameters)) {
+    }
+
+    const Token* token = &parser->token;
+    size_t start = (size_t)(token->lexeme - parser->lexer.source);
+    expression->range = (LexerRange) { start, 0, token->line, (ssize_t)start - token->position };
+    expression->parser = parser;
+
+    if (!parser_check_statements(parser)) {
         return false;
     }
+    expression->range.end = (size_t)(parser->token.lexeme - parser->lexer.source) + 1;
+    return true;
+}
 
-    expression->function.body = (StatementBlock*)malloc(sizeof(StatementBlock));
-    statement_block_init(expression->function.body);
+/*
+ * Parse the body of a function that was skipped when the program was parsed.
+ * The body is allocated from the arena of the parser of the program, and any
+ * functions within it are parsed right away.
+ */
+bool parser_parse_function_body(FunctionExpression* expression, Error* error)
+{
+    Parser* owner = expression->parser;
+    Parser parser;
+    parser_init_range(&parser, owner, &expression->range);
 
-    return parser_parse_block_expression(parser, expression->function.body);
+    StatementBlock* body = (StatementBlock*)arena_allocate(&parser.arena, sizeof(StatementBlock));
+    statement_block_init(body);
+    bool result = parser_parse_block_expression(&parser, body);
+    if (result) {
+        expression->body = body;
+        expression->parser = NULL;
+    } else {
+        statement_block_free(body);
+        *error = parser.error;
+    }
+
+    arena_take(&owner->arena, &parser.arena);
+    return result;
 }
 
-bool parser_parse_call_expression_argument(Parser* parser, List** arguments)
+bool parser_parse_function_expression(Parser* parser, Expression* expression)
 {
-    Expression expression;
-    if (!parser_parse_expression_next(parser, &expression, PRECEDENCE_LOWEST)) {
+    if (!parser_next_expect(parser, TOKEN_LEFT_PAREN, ERROR_EXPRESSION_FUNCTION_EXPECTED_LEFT_PAREN)) {
+        return false;
+    } else if (!expression_init_function(expression)) {
         return false;
-    } else if (!list_append(arguments, (void*)&expression, sizeof(Expression))) {
-        expression_free(&expression);
+    } else if (!parser_parse_function_expression_parameters(parser, &expression->function)) {
         return false;
+    } else if (parser->lazy) {
+        return parser_skip_function_body(parser, &expression->function);
     }
-    return true;
+
+    expression->function.body = (StatementBlock*)arena_allocate(&parser->arena, sizeof(StatementBlock));
+    statement_block_init(expression->function.body);
+
+    return parser_parse_block_expression(parser, expression->function.body);
 }
 
-bool parser_parse_call_expression_arguments(Parser* parser, List** arguments)
+bool parser_parse_call_expression_arguments(Parser* parser, CallExpression* expression)
 {
     // zero arguments
     if (parser_next_if(parser, TOKEN_RIGHT_PAREN)) {
         return true;
     }
 
-    // first argument
-    if (!parser_parse_call_expression_argument(parser, arguments)) {
-        return false;
-    }
-
-    // remaining arguments
-    List* argument = *arguments;
-    while (!parser_next_if(parser, TOKEN_RIGHT_PAREN)) {
-        if (!parser_next_expect(parser, TOKEN_COMMA, ERROR_EXPRESSION_CALL_EXPECTED_COMMA)) {
-            return false;
-        } else if (!parser_parse_call_expression_argument(parser, &argument->next)) {
-            return false;
+    Expression* arguments = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+    bool result = true;
+    do {
+        if (size > 0 && !parser_next_expect(parser, TOKEN_COMMA, ERROR_EXPRESSION_CALL_EXPECTED_COMMA)) {
+            result = false;
+            break;
         }
-        argument = argument->next;
-    }
+        Expression* argument = (Expression*)parser_parse_list_item((void**)&arguments, &size, &capacity, sizeof(Expression));
+        argument->type = EXPRESSION_NONE;
+        if (!parser_parse_expression_next(parser, argument, PRECEDENCE_LOWEST)) {
+            result = false;
+            break;
+        }
+    } while (!parser_next_if(parser, TOKEN_RIGHT_PAREN));
 
-    return true;
+    // arguments parsed before an error are kept so that they are freed with the call
+    expression->arguments = (Expression*)parser_parse_list_finish(parser, arguments, size, sizeof(Expression));
+    expression->arguments_size = size;
+    return result;
 }
 
 bool parser_parse_call_expression(Parser* parser, Expression* expression)
 {
-    if (!expression_init_call(expression, expression_move(expression))) {
+    if (!expression_init_call(expression, expression_move(&parser->arena, expression))) {
         return false;
     }
-    return parser_parse_call_expression_arguments(parser, &expression->call.arguments);
+    return parser_parse_call_expression_arguments(parser, &expression->call);
+}
+
+bool parser_parse_integer_expression(Parser* parser, Expression* expression)
+{
+    unsigned int value = 0;
+    for (size_t i = 0; i < parser->token.length; ++i) {
+        value = 10 * value + (unsigned int)(parser->token.lexeme[i] - '0');
+    }
+    return expression_init_integer(expression, (int)value);
+}
+
+bool parser_parse_string_expression(Parser* parser, Expression* expression)
+{
+    ObjectString* constant = constant_pool_string(parser->constants, parser->token.lexeme, parser->token.length);
+    return expression_init_string(expression, constant);
 }
 
 bool parser_parse_expression_left(Parser* parser, Expression* expression)
 {
     switch (parser->token.type) {
     case TOKEN_IDENTIFIER:
-        return expression_init_identifier(expression, &parser->token.lexeme);
+        return expression_init_identifier(expression, symbol_intern_span(parser->token.lexeme, parser->token.length));
     case TOKEN_INTEGER:
-        return expression_init_integer(expression, atoi(parser->token.lexeme.value));
+        return parser_parse_integer_expression(parser, expression);
     case TOKEN_STRING:
-        return expression_init_string(expression, &parser->token.lexeme);
+        return parser_parse_string_expression(parser, expression);
     case TOKEN_TRUE:
     case TOKEN_FALSE:
         return expression_init_bool(expression, parser->token.type == TOKEN_TRUE);
@@ -254,7 +581,7 @@ bool parser_parse_expression_left(Parser* parser, Expression* expression)
 
 Operation parser_parse_infix_operation(Parser* parser)
 {
-    switch (parser->token_next.type) {
+    switch (parser_peek(parser)->type) {
     case TOKEN_EQUAL:
         return OPERATION_EQUAL;
     case TOKEN_NOT_EQUAL:
@@ -300,7 +627,7 @@ bool parser_parse_expression_right(Parser* parser, Expression* expression, Prece
             return true;
         }
 
-        if (!expression_init_infix(expression, expression_move(expression), operation)) {
+        if (!expression_init_infix(expression, &parser->arena, expression_move(&parser->arena, expression), operation)) {
             return false;
         }
 
@@ -332,7 +659,7 @@ bool parser_parse_let_statement(Parser* parser, Statement* statement)
 {
     if (!parser_next_expect(parser, TOKEN_IDENTIFIER, ERROR_LET_TOKEN_IDENTIFIER)) {
         return false;
-    } else if (!statement_init_let(statement, &parser->token.lexeme)) {
+    } else if (!statement_init_let(statement, symbol_intern_span(parser->token.lexeme, parser->token.length))) {
         return false;
     } else if (!parser_next_expect(parser, TOKEN_ASSIGN, ERROR_LET_TOKEN_ASSIGN)) {
         return false;
@@ -364,6 +691,9 @@ bool parser_parse_expression_statement(Parser* parser, Statement* statement)
 
 bool parser_parse_statement(Parser* parser, Statement* statement)
 {
+    // the statement must be safe to free if parsing fails before it is set up
+    statement_init_expression(statement);
+
     bool result;
     if (parser->token.type == TOKEN_LET) {
         result = parser_parse_let_statement(parser, statement);
@@ -378,12 +708,32 @@ bool parser_parse_statement(Parser* parser, Statement* statement)
     return result;
 }
 
+/*
+ * Parse the next top level statement of a program, for handling it before the
+ * rest of the program is parsed. This fails at the end of the program as well
+ * as on errors, which are distinguished by the error of the parser. A statement
+ * that fails to parse is freed.
+ */
+bool parser_parse_program_next(Parser* parser, Statement* statement)
+{
+    if (!parser_next(parser)) {
+        if (parser->token.type == TOKEN_ILLEGAL) {
+            parser_error(parser, ERROR_TOKEN_ILLEGAL);
+        }
+        return false;
+    } else if (!parser_parse_statement(parser, statement)) {
+        statement_free(statement);
+        return false;
+    }
+    return true;
+}
+
 bool parser_parse_program(Parser* parser, StatementBlock* block)
 {
     while (parser_next(parser)) {
         Statement statement;
         if (parser_parse_statement(parser, &statement)) {
-            statement_block_extend(block, &statement);
+            statement_block_extend(block, &parser->arena, &statement);
         } else {
             statement_free(&statement);
             return false;
@@ -395,3 +745,103 @@ bool parser_parse_program(Parser* parser, StatementBlock* block)
     }
     return true;
 }
+
+typedef struct ParserPool ParserPool;
+struct ParserPool {
+    Parser* chunks;
+    StatementBlock* blocks;
+    bool* results;
+    size_t size;
+    atomic_size_t next;
+    atomic_size_t failed;
+};
+
+/*
+ * Parse chunks in turn until none are left. Chunks following one that failed
+ * to parse are skipped since only the first error is reported.
+ */
+void* parser_parse_worker(void* argument)
+{
+    ParserPool* pool = (ParserPool*)argument;
+    while (true) {
+        size_t i = atomic_fetch_add(&pool->next, 1);
+        if (i >= pool->size) {
+            return NULL;
+        } else if (i > atomic_load(&pool->failed)) {
+            pool->results[i] = true;
+            continue;
+        }
+
+        pool->results[i] = parser_parse_program(&pool->chunks[i], &pool->blocks[i]);
+        if (!pool->results[i]) {
+            size_t failed = atomic_load(&pool->failed);
+            while (i < failed && !atomic_compare_exchange_weak(&pool->failed, &failed, i)) {
+            }
+        }
+    }
+}
+
+/*
+ * Parse a program by splitting its source at top level statement boundaries
+ * and parsing the chunks concurrently on the given number of threads. The
+ * statements of the chunks are joined in source order, and the error reported
+ * is the one of the first chunk that failed to parse, so the result is the
+ * same as that of parsing the program sequentially.
+ */
+bool parser_parse_program_parallel(Parser* parser, StatementBlock* block, size_t jobs)
+{
+    size_t size = jobs * PARSER_CHUNKS_PER_JOB;
+    LexerRange* ranges = (LexerRange*)malloc(size * sizeof(LexerRange));
+    size = lexer_split(&parser->lexer, ranges, size);
+    if (size == 1) {
+        free(ranges);
+        return parser_parse_program(parser, block);
+    }
+
+    ParserPool pool;
+    pool.chunks = (Parser*)malloc(size * sizeof(Parser));
+    pool.blocks = (StatementBlock*)malloc(size * sizeof(StatementBlock));
+    pool.results = (bool*)malloc(size * sizeof(bool));
+    pool.size = size;
+    atomic_init(&pool.next, 0);
+    atomic_init(&pool.failed, size);
+    for (size_t i = 0; i < size; ++i) {
+        parser_init_range(&pool.chunks[i], parser, &ranges[i]);
+        pool.chunks[i].lazy = parser->lazy;
+        statement_block_init(&pool.blocks[i]);
+    }
+    free(ranges);
+
+    size_t threads_size = jobs < size ? jobs : size;
+    pthread_t* threads = (pthread_t*)malloc(threads_size * sizeof(pthread_t));
+    for (size_t i = 0; i < threads_size; ++i) {
+        pthread_create(&threads[i], NULL, parser_parse_worker, &pool);
+    }
+    for (size_t i = 0; i < threads_size; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    bool result = true;
+    for (size_t i = 0; i < size; ++i) {
+        StatementBlock* chunk = &pool.blocks[i];
+        if (chunk->head != NULL) {
+            if (block->head == NULL) {
+                block->head = chunk->head;
+            } else {
+                block->tail->next = chunk->head;
+            }
+            block->tail = chunk->tail;
+        }
+        if (result && !pool.results[i]) {
+            parser->error = pool.chunks[i].error;
+            result = false;
+        }
+    }
+
+    parser->chunks = pool.chunks;
+    parser->chunks_size = size;
+    free(pool.blocks);
+    free(pool.results);
+    return result;
+}
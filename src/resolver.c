@@ -0,0 +1,356 @@
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "monkey/expression.h"
+#include "monkey/hash.h"
+#include "monkey/resolver.h"
+#include "monkey/scope.h"
+#include "monkey/statement.h"
+#include "monkey/symbol.h"
+
+void resolver_init(Resolver* resolver, Scope* global)
+{
+    resolver->global = global;
+    hash_init(&resolver->index);
+    hash_init(&resolver->bound);
+    resolver->scopes = NULL;
+    resolver->size = 0;
+    resolver->capacity = 0;
+    resolver->base = 0;
+    expression_spine_init(&resolver->spine);
+    resolver->function = false;
+    resolver->incremental = false;
+}
+
+void resolver_free_bound(void* value)
+{
+    (void)value;
+}
+
+void resolver_free(Resolver* resolver)
+{
+    hash_free(&resolver->index, free);
+    hash_free(&resolver->bound, resolver_free_bound);
+    free(resolver->scopes);
+    expression_spine_free(&resolver->spine);
+}
+
+/*
+ * Retrieve the slot of a name in the global scope. Every name that is not
+ * bound locally is assigned a global slot the first time it is seen, whether
+ * or not the program ever assigns it, so that references made before the
+ * corresponding let statement still agree on the slot.
+ */
+size_t resolver_global(Resolver* resolver, const Symbol* name)
+{
+    size_t* slot = (size_t*)hash_retrieve_hash(&resolver->index, string_value(&name->name), name->hash);
+    if (slot == NULL) {
+        slot = (size_t*)malloc(sizeof(size_t));
+        *slot = scope_add(resolver->global, name);
+        hash_insert_hash(&resolver->index, string_value(&name->name), name->hash, slot);
+    }
+    return *slot;
+}
+
+void resolver_bind_internal(Resolver* resolver)
+{
+    // internal functions are bound in the global scope
+    resolver_global(resolver, symbol_intern("puts"));
+    resolver_global(resolver, symbol_intern("len"));
+}
+
+/*
+ * Only blocks that declare variables get an environment of their own at
+ * runtime. Blocks without let statements are evaluated in the environment of
+ * the enclosing block and must not count towards the depth of bindings.
+ */
+bool resolver_push(Resolver* resolver, StatementBlock* block, bool parameters)
+{
+    block->scope.size = 0;
+
+    bool declares = parameters;
+    for (Statement* statement = block->head; statement != NULL && !declares; statement = statement->next) {
+        declares = statement->type == STATEMENT_LET;
+    }
+    if (!declares) {
+        return false;
+    }
+
+    if (resolver->size >= resolver->capacity) {
+        resolver->capacity = resolver->capacity == 0 ? 8 : 2 * resolver->capacity;
+        resolver->scopes = (Scope**)realloc(resolver->scopes, resolver->capacity * sizeof(Scope*));
+    }
+    resolver->scopes[resolver->size++] = &block->scope;
+    return true;
+}
+
+void resolver_pop(Resolver* resolver, bool pushed)
+{
+    if (pushed) {
+        resolver->size--;
+    }
+}
+
+/*
+ * Collect the names that are bound anywhere other than the global scope.
+ * Variables are dynamically scoped, so a free name in a function body may
+ * refer to a binding in any of its callers. Only names that no function or
+ * block ever binds are guaranteed to refer to the global scope.
+ */
+void resolve_collect_block(Resolver*, const StatementBlock*, bool);
+
+void resolve_collect_expression(Resolver* resolver, const Expression* expression)
+{
+    // chains of operators are followed down without recursion
+    while (expression->type == EXPRESSION_PREFIX || expression->type == EXPRESSION_INFIX) {
+        if (expression->type == EXPRESSION_PREFIX) {
+            expression = expression->prefix.operand;
+        } else {
+            resolve_collect_expression(resolver, expression->infix.operand[1]);
+            expression = expression->infix.operand[0];
+        }
+    }
+
+    switch (expression->type) {
+    case EXPRESSION_CONDITIONAL:
+        resolve_collect_expression(resolver, expression->conditional.condition);
+        resolve_collect_block(resolver, expression->conditional.consequence, false);
+        if (expression->conditional.alternate != NULL) {
+            resolve_collect_block(resolver, expression->conditional.alternate, false);
+        }
+        break;
+    case EXPRESSION_FUNCTION:
+        for (size_t i = 0; i < expression->function.parameters_size; ++i) {
+            const Symbol* name = expression->function.parameters[i];
+            hash_insert_hash(&resolver->bound, string_value(&name->name), name->hash, (void*)name);
+        }
+        if (expression->function.body != NULL) {
+            resolve_collect_block(resolver, expression->function.body, false);
+        }
+        break;
+    case EXPRESSION_CALL:
+        resolve_collect_expression(resolver, expression->call.function);
+        for (size_t i = 0; i < expression->call.arguments_size; ++i) {
+            resolve_collect_expression(resolver, &expression->call.arguments[i]);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void resolve_collect_block(Resolver* resolver, const StatementBlock* block, bool global)
+{
+    for (Statement* statement = block->head; statement != NULL; statement = statement->next) {
+        if (statement->type == STATEMENT_LET && !global) {
+            const Symbol* name = statement->identifier;
+            hash_insert_hash(&resolver->bound, string_value(&name->name), name->hash, (void*)name);
+        }
+        resolve_collect_expression(resolver, &statement->expression);
+    }
+}
+
+bool resolve_block(Resolver* resolver, StatementBlock* block)
+{
+    for (Statement* statement = block->head; statement != NULL; statement = statement->next) {
+        if (!resolve_statement(resolver, statement)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool resolve_identifier_expression(Resolver* resolver, IdentifierExpression* expression)
+{
+    const Symbol* name = expression->symbol;
+    Binding* binding = &expression->binding;
+
+    for (size_t i = resolver->size; i > resolver->base; --i) {
+        if (scope_find(resolver->scopes[i - 1], name, &binding->slot)) {
+            binding->type = BINDING_LOCAL;
+            binding->depth = resolver->size - i;
+            return true;
+        }
+    }
+
+    binding->slot = resolver_global(resolver, name);
+    binding->depth = 0;
+    // a program resolved one statement at a time may bind any name later
+    if (resolver->function && (resolver->incremental || hash_retrieve_hash(&resolver->bound, string_value(&name->name), name->hash) != NULL)) {
+        binding->type = BINDING_DYNAMIC;
+    } else {
+        binding->type = BINDING_GLOBAL;
+    }
+    return true;
+}
+
+bool resolve_scoped_block(Resolver* resolver, StatementBlock* block)
+{
+    bool pushed = resolver_push(resolver, block, false);
+    bool result = resolve_block(resolver, block);
+    resolver_pop(resolver, pushed);
+    return result;
+}
+
+bool resolve_conditional_expression(Resolver* resolver, ConditionalExpression* expression)
+{
+    if (!resolve_expression(resolver, expression->condition)) {
+        return false;
+    } else if (!resolve_scoped_block(resolver, expression->consequence)) {
+        return false;
+    } else if (expression->alternate != NULL && !resolve_scoped_block(resolver, expression->alternate)) {
+        return false;
+    }
+    return true;
+}
+
+/*
+ * The body of a function is evaluated in an environment that is chained to the
+ * environment of the caller, not to the one where the function was defined.
+ * None of the enclosing local scopes are therefore visible from the body.
+ */
+bool resolve_function_expression(Resolver* resolver, FunctionExpression* expression)
+{
+    if (expression->body == NULL) {
+        // a body that is parsed lazily is resolved once it has been parsed
+        return true;
+    }
+
+    size_t base = resolver->base;
+    bool function = resolver->function;
+
+    bool pushed = resolver_push(resolver, expression->body, expression->parameters_size > 0);
+    resolver->base = pushed ? resolver->size - 1 : resolver->size;
+    resolver->function = true;
+
+    // parameters occupy the first slots, even if names are repeated
+    for (size_t i = 0; i < expression->parameters_size; ++i) {
+        scope_add(&expression->body->scope, expression->parameters[i]);
+    }
+    bool result = resolve_block(resolver, expression->body);
+
+    resolver_pop(resolver, pushed);
+    resolver->base = base;
+    resolver->function = function;
+    return result;
+}
+
+bool resolve_call_expression(Resolver* resolver, CallExpression* expression)
+{
+    if (!resolve_expression(resolver, expression->function)) {
+        return false;
+    }
+    for (size_t i = 0; i < expression->arguments_size; ++i) {
+        if (!resolve_expression(resolver, &expression->arguments[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * The right operands of a chain are resolved in the order of the source.
+ */
+bool resolve_infix_expression(Resolver* resolver, Expression* expression)
+{
+    size_t base = resolver->spine.size;
+    bool result = resolve_expression(resolver, expression_spine_push(&resolver->spine, expression));
+    Expression* infix;
+    while ((infix = expression_spine_pop(&resolver->spine, base)) != NULL) {
+        result = result && resolve_expression(resolver, infix->infix.operand[1]);
+    }
+    return result;
+}
+
+bool resolve_expression(Resolver* resolver, Expression* expression)
+{
+    switch (expression->type) {
+    case EXPRESSION_IDENTIFIER:
+        return resolve_identifier_expression(resolver, &expression->identifier);
+    case EXPRESSION_PREFIX:
+        return resolve_expression(resolver, expression->prefix.operand);
+    case EXPRESSION_INFIX:
+        return resolve_infix_expression(resolver, expression);
+    case EXPRESSION_CONDITIONAL:
+        return resolve_conditional_expression(resolver, &expression->conditional);
+    case EXPRESSION_FUNCTION:
+        return resolve_function_expression(resolver, &expression->function);
+    case EXPRESSION_CALL:
+        return resolve_call_expression(resolver, &expression->call);
+    default:
+        return true;
+    }
+}
+
+/*
+ * Bind the target of a let statement after resolving its value, so that the
+ * value still refers to any previous binding of the same name. Declaring a
+ * name again in the same scope reuses its slot, as the evaluator replaces the
+ * earlier value in the same environment.
+ */
+bool resolve_let_statement(Resolver* resolver, Statement* statement)
+{
+    if (!resolve_expression(resolver, &statement->expression)) {
+        return false;
+    }
+
+    const Symbol* name = statement->identifier;
+    Binding* binding = &statement->binding;
+    binding->depth = 0;
+    if (resolver->size == 0 && !resolver->function) {
+        binding->type = BINDING_GLOBAL;
+        binding->slot = resolver_global(resolver, name);
+        return true;
+    }
+
+    Scope* scope = resolver->scopes[resolver->size - 1];
+    binding->type = BINDING_LOCAL;
+    if (!scope_find(scope, name, &binding->slot)) {
+        binding->slot = scope_add(scope, name);
+    }
+    return true;
+}
+
+bool resolve_statement(Resolver* resolver, Statement* statement)
+{
+    if (statement->type == STATEMENT_LET) {
+        return resolve_let_statement(resolver, statement);
+    }
+    return resolve_expression(resolver, &statement->expression);
+}
+
+/*
+ * Resolve a function whose body was parsed after the rest of the program was
+ * resolved. Names bound anywhere in the program are not known at this point,
+ * so every free name in the body is looked up dynamically. Names that are new
+ * to the program are added to the global scope.
+ */
+bool resolve_function(Scope* global, FunctionExpression* expression)
+{
+    Resolver resolver;
+    resolver_init(&resolver, global);
+    resolver.incremental = true;
+    for (size_t i = 0; i < global->size; ++i) {
+        const Symbol* name = global->names[i];
+        size_t* slot = (size_t*)malloc(sizeof(size_t));
+        *slot = i;
+        free(hash_insert_hash(&resolver.index, string_value(&name->name), name->hash, slot));
+    }
+
+    bool result = resolve_function_expression(&resolver, expression);
+    resolver_free(&resolver);
+    return result;
+}
+
+bool resolve_program(StatementBlock* block)
+{
+    Resolver resolver;
+    block->scope.size = 0;
+    resolver_init(&resolver, &block->scope);
+    resolve_collect_block(&resolver, block, true);
+    resolver_bind_internal(&resolver);
+
+    bool result = resolve_block(&resolver, block);
+    resolver_free(&resolver);
+    return result;
+}
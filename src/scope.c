@@ -0,0 +1,50 @@
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "monkey/scope.h"
+#include "monkey/symbol.h"
+
+void binding_init(Binding* binding)
+{
+    binding->type = BINDING_NONE;
+    binding->depth = 0;
+    binding->slot = 0;
+}
+
+void scope_init(Scope* scope)
+{
+    scope->names = NULL;
+    scope->size = 0;
+    scope->capacity = 0;
+}
+
+void scope_free(const Scope* scope)
+{
+    free(scope->names);
+}
+
+size_t scope_add(Scope* scope, const Symbol* name)
+{
+    if (scope->size >= scope->capacity) {
+        scope->capacity = scope->capacity == 0 ? 4 : 2 * scope->capacity;
+        scope->names = (const Symbol**)realloc(scope->names, scope->capacity * sizeof(Symbol*));
+    }
+    scope->names[scope->size] = name;
+    return scope->size++;
+}
+
+/*
+ * Find the most recently added slot with the given name. Names are only added
+ * once their declaration has been resolved, so an earlier slot with the same
+ * name belongs to a declaration that has since been shadowed.
+ */
+bool scope_find(const Scope* scope, const Symbol* name, size_t* slot)
+{
+    for (size_t i = scope->size; i > 0; --i) {
+        if (scope->names[i - 1] == name) {
+            *slot = i - 1;
+            return true;
+        }
+    }
+    return false;
+}
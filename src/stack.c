@@ -0,0 +1,74 @@
+#include <stdlib.h>
+
+#include "monkey/object.h"
+#include "monkey/stack.h"
+
+/*
+ * The stack is a list of chunks of object slots. Slots handed out by a push
+ * never move, so environments can point into the stack while deeper calls grow
+ * it. Chunks are kept once allocated and reused when the stack grows again.
+ */
+StackChunk* stack_chunk_new(StackChunk* previous, size_t capacity)
+{
+    StackChunk* chunk = (StackChunk*)malloc(sizeof(StackChunk) + capacity * sizeof(Object));
+    chunk->previous = previous;
+    chunk->next = NULL;
+    chunk->size = 0;
+    chunk->capacity = capacity;
+    return chunk;
+}
+
+void stack_chunk_free(StackChunk* chunk)
+{
+    while (chunk != NULL) {
+        StackChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
+void stack_init(Stack* stack)
+{
+    stack->chunk = stack_chunk_new(NULL, 1024);
+}
+
+void stack_free(Stack* stack)
+{
+    StackChunk* chunk = stack->chunk;
+    while (chunk->previous != NULL) {
+        chunk = chunk->previous;
+    }
+    stack_chunk_free(chunk);
+}
+
+Object* stack_push(Stack* stack, size_t size)
+{
+    StackChunk* chunk = stack->chunk;
+    if (chunk->size + size > chunk->capacity) {
+        // unused chunks that are too small are discarded
+        if (chunk->next != NULL && chunk->next->capacity < size) {
+            stack_chunk_free(chunk->next);
+            chunk->next = NULL;
+        }
+        if (chunk->next == NULL) {
+            chunk->next = stack_chunk_new(chunk, 2 * chunk->capacity > size ? 2 * chunk->capacity : size);
+        }
+        chunk = chunk->next;
+        stack->chunk = chunk;
+    }
+
+    Object* objects = &chunk->objects[chunk->size];
+    chunk->size += size;
+    return objects;
+}
+
+void stack_pop(Stack* stack, size_t size)
+{
+    if (size == 0) {
+        return;
+    }
+    while (stack->chunk->size == 0 && stack->chunk->previous != NULL) {
+        stack->chunk = stack->chunk->previous;
+    }
+    stack->chunk->size -= size;
+}
@@ -3,12 +3,13 @@
 #include "monkey/expression.h"
 #include "monkey/statement.h"
 #include "monkey/string.h"
+#include "monkey/symbol.h"
 
-bool statement_init_let(Statement* statement, String* identifier)
+bool statement_init_let(Statement* statement, const Symbol* identifier)
 {
     statement->type = STATEMENT_LET;
-    statement->identifier = (String*)malloc(sizeof(String));
-    string_copy(statement->identifier, identifier);
+    statement->identifier = identifier;
+    binding_init(&statement->binding);
     statement->expression.type = EXPRESSION_NONE;
     statement->next = NULL;
     return true;
@@ -18,6 +19,7 @@ bool statement_init_return(Statement* statement)
 {
     statement->type = STATEMENT_RETURN;
     statement->identifier = NULL;
+    binding_init(&statement->binding);
     statement->expression.type = EXPRESSION_NONE;
     statement->next = NULL;
     return true;
@@ -27,6 +29,7 @@ bool statement_init_expression(Statement* statement)
 {
     statement->type = STATEMENT_EXPRESSION;
     statement->identifier = NULL;
+    binding_init(&statement->binding);
     statement->expression.type = EXPRESSION_NONE;
     statement->next = NULL;
     return true;
@@ -34,14 +37,7 @@ bool statement_init_expression(Statement* statement)
 
 void statement_free(const Statement* statement)
 {
-    if (statement->identifier != NULL) {
-        string_free(statement->identifier);
-    }
     expression_free(&statement->expression);
-    if (statement->next != NULL) {
-        statement_free(statement->next);
-        free(statement->next);
-    }
 }
 
 void statement_print(const Statement* statement, int indent)
@@ -49,7 +45,7 @@ void statement_print(const Statement* statement, int indent)
     if (statement->type == STATEMENT_LET) {
         printf("%*s", indent * 4, "");
         printf("let ");
-        string_print(statement->identifier);
+        string_print(&statement->identifier->name);
         printf(" = ");
         expression_print(&statement->expression, 0, false);
     } else if (statement->type == STATEMENT_RETURN) {
@@ -66,27 +62,39 @@ void statement_block_init(StatementBlock* block)
 {
     block->head = NULL;
     block->tail = NULL;
+    scope_init(&block->scope);
 }
 
+/*
+ * Statements are allocated from the arena of the parser together with the
+ * rest of the tree. Freeing a block only releases the resources its statements
+ * own outside the arena.
+ */
 void statement_block_free(const StatementBlock* block)
 {
-    if (block->head != NULL) {
-        statement_free(block->head);
-        free(block->head);
+    expression_free_block(block);
+}
+
+bool statement_block_contains_function(const StatementBlock* block)
+{
+    for (const Statement* statement = block->head; statement != NULL; statement = statement->next) {
+        if (expression_contains_function(&statement->expression)) {
+            return true;
+        }
     }
+    return false;
 }
 
-void statement_block_extend(StatementBlock* block, const Statement* statement)
+void statement_block_extend(StatementBlock* block, Arena* arena, const Statement* statement)
 {
+    Statement* statement_new = (Statement*)arena_allocate(arena, sizeof(Statement));
+    *statement_new = *statement;
     if (block->head == NULL) {
-        block->head = (Statement*)malloc(sizeof(Statement));
-        *block->head = *statement;
-        block->tail = block->head;
+        block->head = statement_new;
     } else {
-        block->tail->next = (Statement*)malloc(sizeof(Statement));
-        *block->tail->next = *statement;
-        block->tail = block->tail->next;
+        block->tail->next = statement_new;
     }
+    block->tail = statement_new;
 }
 
 void statement_block_print(const StatementBlock* block, int indent)
@@ -1,4 +1,5 @@
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,84 +8,152 @@
 
 void string_init(String* string)
 {
-    string->size = 0;
-    string->position = 0;
     string->value = NULL;
+    string->position = 0;
+    string->size = 0;
+    string->state = STRING_HEAP;
 }
 
 void string_free(const String* string)
 {
-    if (string->value != NULL) {
+    if (string->state == STRING_HEAP) {
         free(string->value);
     }
 }
 
 void string_reset(String* string)
 {
-    if (string->value != NULL) {
+    if (string->state != STRING_HEAP) {
+        memset(string->buffer, 0, STRING_INLINE_SIZE);
+        string->state = 0;
+    } else if (string->value != NULL) {
         memset(string->value, 0, string->size);
+        string->position = 0;
     }
-    string->position = 0;
 }
 
-bool string_append(String* string, char c)
+/*
+ * Retrieve the characters of the string, or NULL if no characters were ever
+ * stored in it.
+ */
+char* string_value(const String* string)
 {
-    if (string->value == NULL) {
-        string->value = (char*)malloc(2);
-        memset(string->value, 0, 2);
-        string->size = 2;
-    } else if (string->position >= string->size - 1) {
-        string->value = (char*)realloc(string->value, 2 * string->size);
-        memset(string->value + string->size, 0, string->size);
-        string->size *= 2;
+    if (string->state != STRING_HEAP) {
+        return (char*)string->buffer;
     }
-    string->value[string->position++] = c;
-    return true;
+    return string->value;
 }
 
-bool string_concatenate(String* string, const String* string_alt)
+size_t string_length(const String* string)
+{
+    return string->state == STRING_HEAP ? string->position : string->state;
+}
+
+void string_set_length(String* string, size_t length)
 {
-    for (size_t i = 0; i < string_alt->position; ++i) {
-        if (!string_append(string, string_alt->value[i])) {
-            return false;
-        }
+    if (string->state == STRING_HEAP) {
+        string->position = (uint32_t)length;
+    } else {
+        string->state = (unsigned char)length;
     }
-    return true;
 }
 
-bool string_copy(String* string, const String* source)
+/*
+ * Ensure the buffer holds at least the given number of characters, including
+ * the terminating null character. Unused characters are kept zeroed.
+ */
+bool string_reserve(String* string, size_t size)
 {
-    string->size = source->size;
-    string->position = source->position;
-    if (source->value == NULL) {
-        string->value = NULL;
+    bool heap = string->state == STRING_HEAP;
+    if (heap && size <= string->size) {
+        return true;
+    } else if (!heap && size <= STRING_INLINE_SIZE) {
+        return true;
+    } else if (heap && string->value == NULL && size <= STRING_INLINE_SIZE) {
+        memset(string->buffer, 0, STRING_INLINE_SIZE);
+        string->state = 0;
+        return true;
+    } else if (size > UINT32_MAX) {
+        return false;
+    }
+
+    size_t length = string_length(string);
+    size_t capacity = 2 * (STRING_INLINE_SIZE + 1);
+    while (capacity < size) {
+        capacity *= 2;
+    }
+    char* value = (char*)malloc(capacity);
+    size_t used = heap ? string->size : STRING_INLINE_SIZE;
+    if (heap && string->value == NULL) {
+        used = 0;
     } else {
-        string->value = (char*)malloc(source->size);
-        memcpy(string->value, source->value, source->size);
+        memcpy(value, string_value(string), used);
     }
+    memset(value + used, 0, capacity - used);
+
+    string_free(string);
+    string->value = value;
+    string->position = (uint32_t)length;
+    string->size = (uint32_t)capacity;
+    string->state = STRING_HEAP;
     return true;
 }
 
-bool string_equal(const String* string, const String* string_alt)
+bool string_append(String* string, char c)
 {
-    if (string->value == NULL && string_alt->value == NULL) {
+    size_t length = string_length(string);
+    if (!string_reserve(string, length + 2)) {
+        return false;
+    }
+    string_value(string)[length] = c;
+    string_set_length(string, length + 1);
+    return true;
+}
+
+bool string_extend(String* string, const char* value, size_t length)
+{
+    size_t position = string_length(string);
+    if (length == 0) {
         return true;
-    } else if (string->value == NULL) {
+    } else if (!string_reserve(string, position + length + 1)) {
         return false;
-    } else if (string_alt->value == NULL) {
+    }
+    memcpy(string_value(string) + position, value, length);
+    string_set_length(string, position + length);
+    return true;
+}
+
+bool string_concatenate(String* string, const String* string_alt)
+{
+    return string_extend(string, string_value(string_alt), string_length(string_alt));
+}
+
+bool string_copy(String* string, const String* source)
+{
+    string_init(string);
+    if (string_value(source) != NULL && !string_reserve(string, string_length(source) + 1)) {
         return false;
     }
-    return strcmp(string->value, string_alt->value) == 0;
+    return string_concatenate(string, source);
 }
 
-int string_length(const String* string)
+bool string_equal(const String* string, const String* string_alt)
 {
-    return string->position;
+    const char* value = string_value(string);
+    const char* value_alt = string_value(string_alt);
+    if (value == NULL && value_alt == NULL) {
+        return true;
+    } else if (value == NULL) {
+        return false;
+    } else if (value_alt == NULL) {
+        return false;
+    }
+    return strcmp(value, value_alt) == 0;
 }
 
 void string_print(const String* string)
 {
-    if (string->value != NULL) {
-        printf("%s", string->value);
+    if (string_value(string) != NULL) {
+        printf("%s", string_value(string));
     }
 }
@@ -0,0 +1,81 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "monkey/hash.h"
+#include "monkey/string.h"
+#include "monkey/symbol.h"
+
+/*
+ * Every identifier of the program is interned in a single table, so that each
+ * name is stored once and names can be compared by pointer. Chunks of a
+ * program may be parsed concurrently, so the table is split into shards by
+ * the top bits of the hash of a name, each locked on its own.
+ */
+#define SYMBOL_SHARD_BITS 6
+#define SYMBOL_SHARDS (1 << SYMBOL_SHARD_BITS)
+
+typedef struct SymbolShard SymbolShard;
+struct SymbolShard {
+    HashTable table;
+    pthread_mutex_t mutex;
+};
+
+static SymbolShard shards[SYMBOL_SHARDS];
+static pthread_once_t shards_once = PTHREAD_ONCE_INIT;
+
+void symbol_shards_init(void)
+{
+    for (size_t i = 0; i < SYMBOL_SHARDS; ++i) {
+        pthread_mutex_init(&shards[i].mutex, NULL);
+    }
+}
+
+void symbol_free(void* value)
+{
+    Symbol* symbol = (Symbol*)value;
+    string_free(&symbol->name);
+    free(symbol);
+}
+
+const Symbol* symbol_intern(const char* name)
+{
+    return symbol_intern_span(name, strlen(name));
+}
+
+/*
+ * Intern a name given by its characters and length, such as the lexeme of an
+ * identifier token. The characters are only copied the first time the name is
+ * seen.
+ */
+const Symbol* symbol_intern_span(const char* name, size_t length)
+{
+    uint64_t hash = hash_key_span(name, length);
+    pthread_once(&shards_once, symbol_shards_init);
+    SymbolShard* shard = &shards[hash >> (64 - SYMBOL_SHARD_BITS)];
+    pthread_mutex_lock(&shard->mutex);
+    Symbol* symbol = (Symbol*)hash_retrieve_span(&shard->table, name, length, hash);
+    if (symbol != NULL) {
+        pthread_mutex_unlock(&shard->mutex);
+        return symbol;
+    }
+
+    symbol = (Symbol*)malloc(sizeof(Symbol));
+    string_init(&symbol->name);
+    string_reserve(&symbol->name, 1);
+    string_extend(&symbol->name, name, length);
+    symbol->hash = hash;
+
+    // the characters of the name stay in place since symbols are never moved
+    hash_insert_hash(&shard->table, string_value(&symbol->name), hash, symbol);
+    pthread_mutex_unlock(&shard->mutex);
+    return symbol;
+}
+
+void symbol_table_free(void)
+{
+    for (size_t i = 0; i < SYMBOL_SHARDS; ++i) {
+        hash_free(&shards[i].table, symbol_free);
+        hash_init(&shards[i].table);
+    }
+}
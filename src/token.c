@@ -1,6 +1,5 @@
 #include <stdio.h>
 
-#include "monkey/string.h"
 #include "monkey/token.h"
 
 void token_init(Token* token, size_t line, ssize_t position)
@@ -8,31 +7,8 @@ void token_init(Token* token, size_t line, ssize_t position)
     token->type = TOKEN_NONE;
     token->line = line;
     token->position = position;
-    string_init(&token->lexeme);
-}
-
-void token_free(const Token* token)
-{
-    string_free(&token->lexeme);
-}
-
-void token_reset(Token* token)
-{
-    token->type = TOKEN_NONE;
-    string_reset(&token->lexeme);
-}
-
-void token_append(Token* token, char c)
-{
-    string_append(&token->lexeme, c);
-}
-
-void token_copy(Token* destination, const Token* source)
-{
-    destination->type = source->type;
-    destination->line = source->line;
-    destination->position = source->position;
-    string_copy(&destination->lexeme, &source->lexeme);
+    token->lexeme = "";
+    token->length = 0;
 }
 
 void token_print(const Token* token)
@@ -45,13 +21,13 @@ void token_print(const Token* token)
         printf("END\n");
         break;
     case TOKEN_ILLEGAL:
-        printf("ILLEGAL(%s)\n", token->lexeme.value);
+        printf("ILLEGAL(%.*s)\n", (int)token->length, token->lexeme);
         break;
     case TOKEN_COMMENT:
-        printf("COMMENT(%s)\n", token->lexeme.value);
+        printf("COMMENT(%.*s)\n", (int)token->length, token->lexeme);
         break;
     case TOKEN_IDENTIFIER:
-        printf("IDENTIFIER(%s)\n", token->lexeme.value);
+        printf("IDENTIFIER(%.*s)\n", (int)token->length, token->lexeme);
         break;
     case TOKEN_LET:
         printf("LET\n");
@@ -69,10 +45,15 @@ void token_print(const Token* token)
         printf("RETURN\n");
         break;
     case TOKEN_INTEGER:
-        printf("INTEGER(%s)\n", token->lexeme.value);
+        printf("INTEGER(%.*s)\n", (int)token->length, token->lexeme);
         break;
     case TOKEN_STRING:
-        printf("STRING(%s)\n", token->lexeme.value);
+        // the lexeme of an empty string used to be a string without characters
+        if (token->length == 0) {
+            printf("STRING((null))\n");
+        } else {
+            printf("STRING(%.*s)\n", (int)token->length, token->lexeme);
+        }
         break;
     case TOKEN_TRUE:
         printf("TRUE\n");
@@ -92,7 +73,7 @@ void token_print(const Token* token)
     case TOKEN_LESS_EQUAL:
     case TOKEN_NOT:
     case TOKEN_NOT_EQUAL:
-        printf("OPERATOR[%s]\n", token->lexeme.value);
+        printf("OPERATOR[%.*s]\n", (int)token->length, token->lexeme);
         break;
     case TOKEN_COMMA:
         printf("COMMA\n");
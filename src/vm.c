@@ -0,0 +1,418 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "monkey/bytecode.h"
+#include "monkey/compiler.h"
+#include "monkey/eval.h"
+#include "monkey/functions.h"
+#include "monkey/object.h"
+#include "monkey/scope.h"
+#include "monkey/symbol.h"
+#include "monkey/vm.h"
+
+void vm_init_internal(VirtualMachine* vm, const char* name, bool (*internal)(Object*))
+{
+    size_t slot;
+    if (scope_find(vm->bytecode->globals, symbol_intern(name), &slot)) {
+        object_init_internal(&vm->globals[slot], internal);
+    }
+}
+
+void vm_init(VirtualMachine* vm, const Bytecode* bytecode)
+{
+    vm->bytecode = bytecode;
+    vm->globals = (Object*)malloc(bytecode->globals->size * sizeof(Object));
+    for (size_t i = 0; i < bytecode->globals->size; ++i) {
+        vm->globals[i].type = OBJECT_NONE;
+        vm->globals[i].returned = false;
+    }
+    vm->stack = NULL;
+    vm->stack_size = 0;
+    vm->stack_capacity = 0;
+    vm->frames = NULL;
+    vm->frames_size = 0;
+    vm->frames_capacity = 0;
+
+    vm_init_internal(vm, "puts", function_puts);
+    vm_init_internal(vm, "len", function_length);
+}
+
+void vm_free(VirtualMachine* vm)
+{
+    for (size_t i = 0; i < vm->stack_size; ++i) {
+        object_free(&vm->stack[i]);
+    }
+    free(vm->stack);
+    for (size_t i = 0; i < vm->bytecode->globals->size; ++i) {
+        object_free(&vm->globals[i]);
+    }
+    free(vm->globals);
+    free(vm->frames);
+}
+
+Object* vm_push(VirtualMachine* vm)
+{
+    if (vm->stack_size >= vm->stack_capacity) {
+        vm->stack_capacity = vm->stack_capacity == 0 ? 256 : 2 * vm->stack_capacity;
+        vm->stack = (Object*)realloc(vm->stack, vm->stack_capacity * sizeof(Object));
+    }
+    return &vm->stack[vm->stack_size++];
+}
+
+/*
+ * Reserve the stack slots of the local variables of a new frame that are not
+ * already occupied by arguments. Unassigned slots are marked as unbound so that
+ * dynamic lookups skip them.
+ */
+Frame* vm_push_frame(VirtualMachine* vm, const Code* code, size_t base)
+{
+    if (vm->frames_size >= vm->frames_capacity) {
+        vm->frames_capacity = vm->frames_capacity == 0 ? 64 : 2 * vm->frames_capacity;
+        vm->frames = (Frame*)realloc(vm->frames, vm->frames_capacity * sizeof(Frame));
+    }
+    for (size_t i = vm->stack_size - base; i < code->locals; ++i) {
+        Object* object = vm_push(vm);
+        object->type = OBJECT_NONE;
+        object->returned = false;
+    }
+
+    Frame* frame = &vm->frames[vm->frames_size++];
+    frame->code = code;
+    frame->ip = code->bytes;
+    frame->base = base;
+    return frame;
+}
+
+size_t vm_read_operand(const uint8_t** ip)
+{
+    const uint8_t* bytes = *ip;
+    size_t operand = ((size_t)bytes[0] << 24) | ((size_t)bytes[1] << 16) | ((size_t)bytes[2] << 8) | bytes[3];
+    *ip += BYTECODE_OPERAND_SIZE;
+    return operand;
+}
+
+bool vm_get_global(VirtualMachine* vm, size_t slot)
+{
+    const Object* object = &vm->globals[slot];
+    if (object->type == OBJECT_NONE) {
+        printf("*** EVALUATION ERROR: missing variable: %s\n", string_value(&vm->bytecode->globals->names[slot]->name));
+        return false;
+    }
+    object_copy(vm_push(vm), object);
+    return true;
+}
+
+/*
+ * Variables are dynamically scoped: a name that is not bound in the scope of
+ * the running function refers to the most recent binding in the chain of
+ * callers. Search the locals of each active frame, innermost first, before
+ * falling back to the global slot for the name.
+ */
+bool vm_get_name(VirtualMachine* vm, size_t slot)
+{
+    const Symbol* name = vm->bytecode->globals->names[slot];
+    for (size_t i = vm->frames_size; i > 0; --i) {
+        const Frame* frame = &vm->frames[i - 1];
+        for (size_t j = frame->code->locals; j > 0; --j) {
+            Object object = vm->stack[frame->base + j - 1];
+            if (object.type != OBJECT_NONE && frame->code->names[j - 1] == name) {
+                object_copy(vm_push(vm), &object);
+                return true;
+            }
+        }
+    }
+    return vm_get_global(vm, slot);
+}
+
+void vm_set(VirtualMachine* vm, Object* object)
+{
+    object_free(object);
+    *object = vm->stack[--vm->stack_size];
+}
+
+bool vm_prefix(VirtualMachine* vm, Operation operation)
+{
+    return evaluate_prefix_operation(operation, &vm->stack[vm->stack_size - 1]);
+}
+
+bool vm_infix(VirtualMachine* vm, Operation operation)
+{
+    Object* object_right = &vm->stack[vm->stack_size - 1];
+    bool result = evaluate_infix_operation(operation, object_right - 1, object_right);
+    object_free(object_right);
+    vm->stack_size--;
+    return result;
+}
+
+bool vm_call_check_internal(size_t count)
+{
+    if (count < 1) {
+        printf("*** EVALUATION ERROR: not enough arguments in call expression\n");
+        return false;
+    } else if (count > 1) {
+        printf("*** EVALUATION ERROR: too many arguments in call expression\n");
+        return false;
+    }
+    return true;
+}
+
+bool vm_call_internal(VirtualMachine* vm, Object* object_fn, size_t count)
+{
+    if (!vm_call_check_internal(count)) {
+        return false;
+    } else if (!object_fn->internal(&vm->stack[vm->stack_size - 1])) {
+        return false;
+    }
+    *object_fn = vm->stack[--vm->stack_size];
+    return true;
+}
+
+/*
+ * Check that the function below the arguments evaluated so far accepts
+ * another argument, before that argument is evaluated.
+ */
+bool vm_argument_check(const VirtualMachine* vm, size_t index, size_t count)
+{
+    const Object* object = &vm->stack[vm->stack_size - index - 1];
+    if (object->type == OBJECT_INTERNAL) {
+        return vm_call_check_internal(count);
+    } else if (object->type != OBJECT_FUNCTION) {
+        printf("*** EVALUATION ERROR: non-function object in call expression\n");
+        return false;
+    } else if (vm->bytecode->codes[object->function->code].parameters <= index) {
+        printf("*** EVALUATION ERROR: too many arguments in call expression\n");
+        return false;
+    }
+    return true;
+}
+
+bool vm_call_check(const Code* code, size_t count)
+{
+    if (count < code->parameters) {
+        printf("*** EVALUATION ERROR: not enough arguments in call expression\n");
+        return false;
+    } else if (count > code->parameters) {
+        printf("*** EVALUATION ERROR: too many arguments in call expression\n");
+        return false;
+    }
+    return true;
+}
+
+bool vm_run(VirtualMachine* vm)
+{
+    const Bytecode* bytecode = vm->bytecode;
+    Frame* frame = vm_push_frame(vm, &bytecode->codes[0], vm->stack_size);
+    const uint8_t* ip = frame->ip;
+
+    while (true) {
+        Object* object;
+        Object* object_right;
+        size_t operand;
+
+        switch ((Opcode)*ip++) {
+        case OPCODE_CONSTANT:
+            operand = vm_read_operand(&ip);
+            object_copy(vm_push(vm), &bytecode->constants[operand]);
+            break;
+        case OPCODE_NULL:
+            object = vm_push(vm);
+            object->type = OBJECT_NULL;
+            object->returned = false;
+            break;
+        case OPCODE_TRUE:
+            object_init_bool(vm_push(vm), true);
+            break;
+        case OPCODE_FALSE:
+            object_init_bool(vm_push(vm), false);
+            break;
+        case OPCODE_POP:
+            object_free(&vm->stack[--vm->stack_size]);
+            break;
+        case OPCODE_GET_LOCAL:
+            operand = vm_read_operand(&ip);
+            object = vm_push(vm);
+            object_copy(object, &vm->stack[frame->base + operand]);
+            break;
+        case OPCODE_SET_LOCAL:
+            operand = vm_read_operand(&ip);
+            vm_set(vm, &vm->stack[frame->base + operand]);
+            break;
+        case OPCODE_UNSET_LOCAL:
+            operand = vm_read_operand(&ip);
+            object = &vm->stack[frame->base + operand];
+            object_free(object);
+            object->type = OBJECT_NONE;
+            break;
+        case OPCODE_GET_GLOBAL:
+            if (!vm_get_global(vm, vm_read_operand(&ip))) {
+                return false;
+            }
+            break;
+        case OPCODE_SET_GLOBAL:
+            operand = vm_read_operand(&ip);
+            vm_set(vm, &vm->globals[operand]);
+            break;
+        case OPCODE_GET_NAME:
+            if (!vm_get_name(vm, vm_read_operand(&ip))) {
+                return false;
+            }
+            break;
+        case OPCODE_NEGATIVE:
+            if (!vm_prefix(vm, OPERATION_NEGATIVE)) {
+                return false;
+            }
+            break;
+        case OPCODE_NOT:
+            if (!vm_prefix(vm, OPERATION_NOT)) {
+                return false;
+            }
+            break;
+        case OPCODE_EQUAL:
+            if (!vm_infix(vm, OPERATION_EQUAL)) {
+                return false;
+            }
+            break;
+        case OPCODE_NOT_EQUAL:
+            if (!vm_infix(vm, OPERATION_NOT_EQUAL)) {
+                return false;
+            }
+            break;
+        case OPCODE_GREATER:
+            if (!vm_infix(vm, OPERATION_GREATER)) {
+                return false;
+            }
+            break;
+        case OPCODE_GREATER_EQUAL:
+            if (!vm_infix(vm, OPERATION_GREATER_EQUAL)) {
+                return false;
+            }
+            break;
+        case OPCODE_LESS:
+            if (!vm_infix(vm, OPERATION_LESS)) {
+                return false;
+            }
+            break;
+        case OPCODE_LESS_EQUAL:
+            if (!vm_infix(vm, OPERATION_LESS_EQUAL)) {
+                return false;
+            }
+            break;
+        case OPCODE_ADD:
+            object_right = &vm->stack[vm->stack_size - 1];
+            object = object_right - 1;
+            if (object->type == OBJECT_INTEGER && object_right->type == OBJECT_INTEGER) {
+                object->integer += object_right->integer;
+                vm->stack_size--;
+            } else if (!vm_infix(vm, OPERATION_ADD)) {
+                return false;
+            }
+            break;
+        case OPCODE_SUBTRACT:
+            object_right = &vm->stack[vm->stack_size - 1];
+            object = object_right - 1;
+            if (object->type == OBJECT_INTEGER && object_right->type == OBJECT_INTEGER) {
+                object->integer -= object_right->integer;
+                vm->stack_size--;
+            } else if (!vm_infix(vm, OPERATION_SUBTRACT)) {
+                return false;
+            }
+            break;
+        case OPCODE_MULTIPLY:
+            if (!vm_infix(vm, OPERATION_MULTIPLY)) {
+                return false;
+            }
+            break;
+        case OPCODE_DIVIDE:
+            if (!vm_infix(vm, OPERATION_DIVIDE)) {
+                return false;
+            }
+            break;
+        case OPCODE_JUMP:
+            operand = vm_read_operand(&ip);
+            ip = frame->code->bytes + operand;
+            break;
+        case OPCODE_JUMP_FALSE:
+            operand = vm_read_operand(&ip);
+            object = &vm->stack[--vm->stack_size];
+            if (object->type != OBJECT_BOOL) {
+                object_free(object);
+                printf("*** EVALUATION ERROR: non-bool result in conditional expression\n");
+                return false;
+            } else if (!object->boolean) {
+                ip = frame->code->bytes + operand;
+            }
+            break;
+        case OPCODE_JUMP_UNMARKED:
+            operand = vm_read_operand(&ip);
+            if (!vm->stack[vm->stack_size - 1].returned) {
+                ip = frame->code->bytes + operand;
+            }
+            break;
+        case OPCODE_ARGUMENT:
+            operand = *ip++;
+            if (!vm_argument_check(vm, operand, *ip++)) {
+                return false;
+            }
+            break;
+        case OPCODE_CALL:
+            operand = *ip++;
+            object = &vm->stack[vm->stack_size - operand - 1];
+            if (object->type == OBJECT_INTERNAL) {
+                if (!vm_call_internal(vm, object, operand)) {
+                    return false;
+                }
+            } else if (object->type == OBJECT_FUNCTION) {
+                const Code* code = &bytecode->codes[object->function->code];
+                if (!vm_call_check(code, operand)) {
+                    return false;
+                }
+                frame->ip = ip;
+                frame = vm_push_frame(vm, code, vm->stack_size - operand);
+                ip = frame->ip;
+            } else {
+                printf("*** EVALUATION ERROR: non-function object in call expression\n");
+                return false;
+            }
+            break;
+        case OPCODE_RETURN: {
+            Object result = vm->stack[--vm->stack_size];
+            result.returned = false;
+            while (vm->stack_size > frame->base) {
+                object_free(&vm->stack[--vm->stack_size]);
+            }
+            if (--vm->frames_size == 0) {
+                object_free(&result);
+                return true;
+            }
+            // replace the function object below the frame with the result
+            object_free(&vm->stack[vm->stack_size - 1]);
+            vm->stack[vm->stack_size - 1] = result;
+            frame = &vm->frames[vm->frames_size - 1];
+            ip = frame->ip;
+            break;
+        }
+        case OPCODE_MARK_RETURN:
+            vm->stack[vm->stack_size - 1].returned = true;
+            break;
+        default:
+            printf("*** EVALUATION ERROR: unrecognized instruction\n");
+            return false;
+        }
+    }
+}
+
+void vm_execute_program(StatementBlock* block)
+{
+    Bytecode bytecode;
+    bytecode_init(&bytecode);
+
+    if (compile_program(&bytecode, block)) {
+        VirtualMachine vm;
+        vm_init(&vm, &bytecode);
+        vm_run(&vm);
+        vm_free(&vm);
+    }
+
+    bytecode_free(&bytecode);
+}